@@ -1,10 +1,15 @@
 #ifndef GRAMMAR_PARSER_HPP
 #define GRAMMAR_PARSER_HPP
 
+#include <atomic>
+#include <cstdint>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <optional>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
 #include <variant>
@@ -13,27 +18,82 @@
 namespace grammar {
 
 // 辅助函数：检查字符串是否以特定字符开始并以特定字符结束
-bool match_ends(const std::string &src, const char start, const char end);
+bool match_ends(std::string_view src, const char start, const char end);
+
+// 符号名的编号，在加载语法时分配，之后符号只按编号比较与散列
+using SymbolId = uint32_t;
+
+// 全局符号表：把终结符的值、非终结符名等字符串映射为稠密的编号
+// 名字只在导出和打印时通过编号取回；可以被多个线程同时使用
+// 文法加载完成后冻结，之后只读，查找与取名不再加锁
+class SymbolTable {
+private:
+  std::deque<std::string> names; // 下标即编号，deque 保证元素地址不变
+  std::unordered_map<std::string_view, SymbolId> ids; // 键指向 names 中的元素
+  mutable std::shared_mutex mutex;
+  std::atomic<bool> frozen{false};
+
+  SymbolTable() = default;
+
+public:
+  SymbolTable(const SymbolTable &) = delete;
+  SymbolTable &operator=(const SymbolTable &) = delete;
+
+  static SymbolTable &global();
+
+  // 返回名字的编号，第一次出现时分配新编号，冻结后出现新名字时抛出异常
+  SymbolId intern(std::string_view name);
+
+  // 返回已有名字的编号，不分配新编号
+  std::optional<SymbolId> find(std::string_view name) const;
+
+  const std::string &name(SymbolId id) const;
+
+  size_t size() const;
+
+  // 冻结符号表，之后不能再加入新名字
+  void freeze();
+};
+
+// 全局符号表的便捷函数
+inline SymbolId intern_symbol(std::string_view name) {
+  return SymbolTable::global().intern(name);
+}
+
+inline const std::string &symbol_name(SymbolId id) {
+  return SymbolTable::global().name(id);
+}
 
 struct Terminal {
-  std::string value;
+  SymbolId id; // 终结符值的编号
+  // 为真时表示由正则子文法提升得到的词法记号，值为原非终结符名
+  bool is_token = false;
 
-  Terminal(std::string value) : value(value) {}
+  Terminal(std::string_view value, bool is_token = false)
+      : id(intern_symbol(value)), is_token(is_token) {}
 
-  static std::optional<Terminal> parse(const std::string &str);
+  const std::string &value() const { return symbol_name(id); }
+
+  static std::optional<Terminal> parse(std::string_view str);
   std::string to_string() const;
 
-  bool operator==(const Terminal &other) const { return value == other.value; }
+  bool operator==(const Terminal &other) const {
+    return id == other.id && is_token == other.is_token;
+  }
 };
 
 struct NonTerminal {
-  std::string name;
+  SymbolId id; // 非终结符名的编号
+
+  NonTerminal(std::string_view name) : id(intern_symbol(name)) {}
+  explicit NonTerminal(SymbolId id) : id(id) {}
+
+  const std::string &name() const { return symbol_name(id); }
 
-  NonTerminal(std::string name) : name(name) {}
-  static std::optional<NonTerminal> parse(const std::string &str);
+  static std::optional<NonTerminal> parse(std::string_view str);
   std::string to_string() const;
 
-  bool operator==(const NonTerminal &other) const { return name == other.name; }
+  bool operator==(const NonTerminal &other) const { return id == other.id; }
 };
 
 using Symbol = std::variant<Terminal, NonTerminal>;
@@ -45,7 +105,7 @@ struct ASTRule {
   ASTRule(bool do_flatten, bool use_all_children, std::vector<size_t> children)
       : do_flatten(do_flatten), use_all_children(use_all_children),
         children(children) {}
-  static std::optional<ASTRule> parse(const std::string &str);
+  static std::optional<ASTRule> parse(std::string_view str);
   std::string to_string() const;
 };
 
@@ -54,7 +114,7 @@ struct ProductionList {
 
   ProductionList(std::vector<std::vector<Symbol>> production)
       : production(production) {}
-  static std::optional<ProductionList> parse(const std::string &str);
+  static std::optional<ProductionList> parse(std::string_view str);
   std::string to_string() const;
 };
 
@@ -67,34 +127,98 @@ struct GrammarRule {
               std::string sematic_actions)
       : left(left), right(right), ast_rule(ast_rule),
         sematic_actions(sematic_actions) {}
-  static std::optional<GrammarRule> parse(const std::string &str);
+  static std::optional<GrammarRule> parse(std::string_view str);
   std::string to_string() const;
 };
 
+// 一次向前扫描切分出各条规则，跟踪注释行、续行与未闭合的语义动作块
+// 规则在原文中连续时直接以切片交给 GrammarRule::parse，不复制
 std::optional<std::vector<GrammarRule>>
-parse_grammar(const std::string &grammar_str);
+parse_grammar(std::string_view grammar_str);
 
 std::optional<std::vector<GrammarRule>>
 parse_grammar_from_file(const std::string &filename);
 
+// 只读映射的语法文件，解析直接在映射上进行
+class GrammarFile {
+private:
+  const char *data = nullptr;
+  size_t size = 0;
+
+  void release();
+
+public:
+  GrammarFile() = default;
+  GrammarFile(const GrammarFile &) = delete;
+  GrammarFile &operator=(const GrammarFile &) = delete;
+  GrammarFile(GrammarFile &&other) noexcept;
+  GrammarFile &operator=(GrammarFile &&other) noexcept;
+  ~GrammarFile() { release(); }
+
+  static std::optional<GrammarFile> map(const std::string &filename);
+
+  std::string_view view() const { return std::string_view(data, size); }
+};
+
+// 语法文本的 FNV-1a 散列，用于判断预先生成的表是否仍与语法一致
+uint64_t hash_grammar_text(std::string_view text);
+
 void print_grammar(const std::vector<GrammarRule> &grammar);
 
+// 字节级非确定有限自动机，描述被提升为词法记号的正则子文法
+struct ByteNfa {
+  struct State {
+    std::vector<std::pair<unsigned char, int>> edges; // 字节转移
+    std::vector<int> epsilon;                         // 空转移
+  };
+
+  std::vector<State> states;
+  int start = 0;
+  int accept = 0;
+
+  int add_state() {
+    states.emplace_back();
+    return static_cast<int>(states.size() - 1);
+  }
+};
+
+// 由正则子文法提升得到的词法记号
+struct LexicalToken {
+  std::string name; // 被提升的非终结符名，同时是记号终结符的值
+  ByteNfa nfa;      // 识别该非终结符语言的自动机
+};
+
+// 词法提升的结果
+struct LexicalPromotion {
+  std::vector<LexicalToken> tokens;
+  // 只出现在词法辅助规则中的终结符，与记号匹配长度相同时让位于记号
+  std::vector<Terminal> helper_terminals;
+};
+
 struct Grammar {
-  std::unordered_map<std::string, std::vector<GrammarRule>> rule_map;
+  // 左侧非终结符编号 -> 规则
+  std::unordered_map<SymbolId, std::vector<GrammarRule>> rule_map;
+  // 左侧非终结符按在语法文件中首次出现的顺序排列，与散列顺序无关
+  std::vector<SymbolId> order;
 
   Grammar(const std::vector<GrammarRule> &rules) {
     for (const auto &rule : rules) {
-      if (rule_map.find(rule.left.name) == rule_map.end()) {
-        rule_map[rule.left.name] = {rule};
-      } else {
-        rule_map[rule.left.name].push_back(rule);
+      auto &list = rule_map[rule.left.id];
+      if (list.empty()) {
+        order.push_back(rule.left.id);
       }
+      list.push_back(rule);
     }
   }
 
   std::vector<NonTerminal> find_undefined_non_terminals() const;
 
+  // 返回按值排序的终结符，下标即终结符编号
   std::vector<grammar::Terminal> extract_terminals() const;
+
+  // 将语言为正则的词法辅助非终结符提升为单个词法记号
+  // 被提升的非终结符从规则中移除，引用处替换为记号终结符
+  LexicalPromotion promote_regular_nonterminals();
 };
 
 } // namespace grammar
@@ -102,13 +226,13 @@ struct Grammar {
 namespace std {
 template <> struct hash<grammar::NonTerminal> {
   size_t operator()(const grammar::NonTerminal &nt) const noexcept {
-    return hash<std::string>{}(nt.name);
+    return nt.id;
   }
 };
 
 template <> struct hash<grammar::Terminal> {
   size_t operator()(const grammar::Terminal &t) const noexcept {
-    return hash<std::string>{}(t.value);
+    return (static_cast<size_t>(t.id) << 1) | static_cast<size_t>(t.is_token);
   }
 };
 } // namespace std
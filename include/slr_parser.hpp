@@ -1,15 +1,26 @@
 #ifndef SLR_PARSER_HPP
 #define SLR_PARSER_HPP
 
+#include <algorithm>
+#include <bit>
+#include <cstdint>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <span>
 #include <sstream>
 #include <stack>
+#include <string_view>
 #include <variant>
 #include <vector>
 
 #include "./nlohmann/json.hpp"
 #include "grammar_parser.hpp"
 
+namespace tokenizer {
+struct TokenStream;
+} // namespace tokenizer
+
 namespace slr {
 
 enum class SLRSymbolType {
@@ -30,15 +41,20 @@ inline bool is_non_terminal(SLRSymbolType type) {
 }
 
 struct SLRSymbol {
-  std::string value;
+  grammar::SymbolId id; // 符号名在全局符号表中的编号
   SLRSymbolType type;
-  SLRSymbol(std::string value, SLRSymbolType type) : value(value), type(type) {}
+  SLRSymbol(std::string_view value, SLRSymbolType type)
+      : id(grammar::intern_symbol(value)), type(type) {}
+  SLRSymbol(grammar::SymbolId id, SLRSymbolType type) : id(id), type(type) {}
   SLRSymbol(grammar::Symbol sym) {
     if (std::holds_alternative<grammar::Terminal>(sym)) {
-      value = std::get<grammar::Terminal>(sym).value;
-      type = SLRSymbolType::TERMINAL;
+      // 词法记号以原非终结符名作为分析表中的终结符
+      const auto &terminal = std::get<grammar::Terminal>(sym);
+      id = terminal.id;
+      type = terminal.is_token ? SLRSymbolType::SPECIAL_TERMINAL
+                               : SLRSymbolType::TERMINAL;
     } else if (std::holds_alternative<grammar::NonTerminal>(sym)) {
-      value = std::get<grammar::NonTerminal>(sym).name;
+      id = std::get<grammar::NonTerminal>(sym).id;
       type = SLRSymbolType::NON_TERMINAL;
     } else {
       throw std::runtime_error("Invalid symbol type");
@@ -50,34 +66,104 @@ struct SLRSymbol {
   static SLRSymbol get_eos_symbol() {
     return SLRSymbol("#", SLRSymbolType::SPECIAL_NON_TERMINAL);
   }
+  const std::string &value() const { return grammar::symbol_name(id); }
   std::string to_string() const;
   bool operator==(const SLRSymbol &other) const {
-    return value == other.value && type == other.type;
+    return id == other.id && type == other.type;
+  }
+};
+} // namespace slr
+
+namespace std {
+template <> struct hash<slr::SLRSymbol> {
+  size_t operator()(const slr::SLRSymbol &symbol) const noexcept {
+    return (static_cast<size_t>(symbol.id) << 2) |
+           static_cast<size_t>(symbol.type);
+  }
+};
+} // namespace std
+
+namespace slr {
+
+// 定长位集，求并时按 64 位字整体进行
+class Bitset {
+private:
+  std::vector<uint64_t> words;
+  size_t bits = 0;
+
+public:
+  Bitset() = default;
+  explicit Bitset(size_t size) : words((size + 63) / 64, 0), bits(size) {}
+
+  size_t size() const { return bits; }
+
+  void set(size_t i) { words[i >> 6] |= uint64_t{1} << (i & 63); }
+
+  bool test(size_t i) const { return (words[i >> 6] >> (i & 63)) & 1; }
+
+  void clear() { std::fill(words.begin(), words.end(), 0); }
+
+  // 并入 other，返回是否出现了新的位
+  bool merge(const Bitset &other) {
+    uint64_t added = 0;
+    for (size_t i = 0; i < words.size(); i++) {
+      uint64_t word = words[i] | other.words[i];
+      added |= word ^ words[i];
+      words[i] = word;
+    }
+    return added != 0;
+  }
+
+  size_t count() const {
+    size_t result = 0;
+    for (auto word : words) {
+      result += static_cast<size_t>(std::popcount(word));
+    }
+    return result;
   }
+
+  // 按下标从小到大访问每个置位
+  template <typename F> void for_each(F f) const {
+    for (size_t i = 0; i < words.size(); i++) {
+      for (uint64_t word = words[i]; word != 0; word &= word - 1) {
+        f(i * 64 + static_cast<size_t>(std::countr_zero(word)));
+      }
+    }
+  }
+
+  bool operator==(const Bitset &other) const = default;
 };
 
+// DeRemer–Pennello 的 Digraph 算法：F(x) = F'(x) ∪ ⋃{ F(y) | x R y }
+// sets 传入 F'，返回时为 F。按强连通分量的逆拓扑序一次求出，
+// 同一分量中的结点得到相同的集合
+void digraph(const std::vector<std::vector<uint32_t>> &relation,
+             std::vector<Bitset> &sets);
+
+// 产生式，右部与 AST 规则都引用扁平文法中的存储，复制代价很小
+// 引用的存储由 SLR1Parser 持有，语法树中的产生式不能比解析器存活得更久
 struct Production {
-  std::string left;             // 左侧非终结符
-  std::vector<SLRSymbol> right; // 右侧符号序列
-  std::vector<size_t> ast_children;
+  grammar::SymbolId left;                // 左侧非终结符
+  std::span<const SLRSymbol> right;      // 右侧符号序列
+  std::span<const size_t> ast_children;
   bool do_flatten = false;
   bool use_all_children = false;
-  std::string sematic_actions;
+  std::string_view sematic_actions;
 
-  Production(std::string left, std::vector<SLRSymbol> right,
-             std::vector<size_t> ast_children, bool do_flatten,
-             bool use_all_children, std::string sematic_actions)
+  Production(grammar::SymbolId left, std::span<const SLRSymbol> right,
+             std::span<const size_t> ast_children, bool do_flatten,
+             bool use_all_children, std::string_view sematic_actions)
       : left(left), right(right), ast_children(ast_children),
         do_flatten(do_flatten), use_all_children(use_all_children),
         sematic_actions(sematic_actions) {}
 
   bool operator==(const Production &other) const {
-    return left == other.left && right == other.right;
+    return left == other.left && std::ranges::equal(right, other.right);
   }
 
   std::string to_string() const {
     std::stringstream ss;
-    ss << left << " -> ";
+    ss << grammar::symbol_name(left) << " -> ";
     for (size_t i = 0; i < right.size(); i++) {
       ss << right[i].to_string();
       if (i != right.size() - 1) {
@@ -100,39 +186,129 @@ struct Production {
   }
 };
 
+struct CompiledGrammar;
+
+// LR(0) 项目：扁平文法中的产生式编号与点的位置
 struct LR0Item {
-  std::string non_terminal;
-  std::vector<SLRSymbol> production;
-  size_t dot_position;
+  uint32_t production;
+  uint32_t dot_position;
 
-  LR0Item(std::string nt, std::vector<SLRSymbol> prod, size_t pos)
-      : non_terminal(nt), production(prod), dot_position(pos) {}
+  bool operator==(const LR0Item &other) const = default;
+  auto operator<=>(const LR0Item &other) const = default;
 
-  bool operator==(const LR0Item &other) const {
-    return non_terminal == other.non_terminal &&
-           production == other.production && dot_position == other.dot_position;
+  std::string to_string(const CompiledGrammar &grammar) const;
+};
+
+// 排好序的核心项目的散列值，用于查找已有状态
+size_t hash_kernel(const std::vector<LR0Item> &kernel);
+
+// 编译后的扁平文法，构造后只读
+// 产生式按语法文件中的顺序编号，同一非终结符的产生式编号相邻，0 号为增广产生式
+// 全部产生式的右部首尾相接存放在 symbols 中
+struct CompiledGrammar {
+  struct ProductionEntry {
+    uint32_t non_terminal; // 左侧非终结符的下标
+    uint32_t offset;       // 右部在 symbols 中的起点
+    uint32_t length;       // 右部长度
+    uint32_t rule;         // 所属语法规则在 rules 中的下标
+  };
+
+  // 同一条语法规则的各个候选共用 AST 规则与语义动作
+  struct RuleEntry {
+    std::vector<size_t> ast_children;
+    bool do_flatten = false;
+    bool use_all_children = false;
+    std::string sematic_actions;
+  };
+
+  std::vector<SLRSymbol> symbols;
+  // symbols 中每个符号的下标：终结符为终结符下标，非终结符为非终结符下标
+  std::vector<uint32_t> symbol_index;
+  std::vector<ProductionEntry> productions;
+  std::vector<RuleEntry> rules;
+
+  // 终结符下标 -> 符号，与 Grammar::extract_terminals 的下标一致
+  // 最后一个为结束符号 #
+  std::vector<SLRSymbol> terminals;
+  std::unordered_map<SLRSymbol, uint32_t> terminal_index;
+
+  // 非终结符下标 -> 编号，按在语法文件中首次定义的顺序，0 号为增广开始符号
+  std::vector<grammar::SymbolId> non_terminals;
+  // 非终结符 i 的产生式编号为 [production_begin[i], production_begin[i + 1])
+  std::vector<uint32_t> production_begin;
+  std::unordered_map<grammar::SymbolId, uint32_t> non_terminal_index;
+
+  static CompiledGrammar compile(const grammar::Grammar &grammar,
+                                 grammar::SymbolId start_symbol,
+                                 grammar::SymbolId augmented_start_symbol);
+
+  std::span<const SLRSymbol> rhs(size_t production) const {
+    const auto &entry = productions[production];
+    return std::span<const SLRSymbol>(symbols).subspan(entry.offset,
+                                                       entry.length);
   }
 
-  std::string to_string() const;
-};
-} // namespace slr
+  grammar::SymbolId left(size_t production) const {
+    return non_terminals[productions[production].non_terminal];
+  }
 
-namespace std {
-template <> struct hash<slr::SLRSymbol> {
-  size_t operator()(const slr::SLRSymbol &symbol) const noexcept {
-    return std::hash<std::string>{}(symbol.to_string());
+  uint32_t eos() const { return static_cast<uint32_t>(terminals.size() - 1); }
+
+  // 第 production 个产生式的视图
+  Production production(size_t production) const;
+
+  // 非终结符编号对应的下标，未定义时为空
+  std::optional<uint32_t> find_non_terminal(grammar::SymbolId name) const {
+    auto it = non_terminal_index.find(name);
+    if (it == non_terminal_index.end()) {
+      return std::nullopt;
+    }
+    return it->second;
   }
+
+  // 根据 non_terminal_index 与 terminal_index 重新填写 symbol_index
+  // 未定义的非终结符记为 UINT32_MAX
+  void index_symbols();
+
+  // 只保留 keep 中为真的非终结符，以及右部只引用这些非终结符的产生式
+  // 剩余产生式保持原有的相对顺序，语法规则的下标不变
+  CompiledGrammar prune(const std::vector<bool> &keep) const;
 };
 
+// 文法的静态分析，各集合按非终结符下标存放
+// 每项分析都用工作表在产生式图上一次传播完成，代价与文法大小成线性
+struct GrammarAnalysis {
+  std::vector<bool> productive; // 能推导出终结符串
+  std::vector<bool> reachable;  // 只经可产生的产生式能从开始符号到达
+  std::vector<bool> nullable;   // 能推导出空串
+  std::vector<grammar::SymbolId> undefined; // 被引用但没有定义的非终结符
+  // 经由可空前缀（后缀）相互调用的非终结符环，即左（右）递归
+  std::vector<std::vector<grammar::SymbolId>> left_recursive;
+  std::vector<std::vector<grammar::SymbolId>> right_recursive;
+
+  static GrammarAnalysis analyze(const CompiledGrammar &grammar);
+
+  // 可以保留的非终结符：可产生且可达
+  std::vector<bool> useful() const;
+
+  // 存在未定义、不可产生或不可达的非终结符
+  bool has_useless_symbols() const;
+
+  void print_report(const CompiledGrammar &grammar, std::ostream &out) const;
+};
+} // namespace slr
+
+namespace std {
 template <> struct hash<slr::LR0Item> {
   size_t operator()(const slr::LR0Item &item) const noexcept {
-    return std::hash<std::string>{}(item.to_string());
+    return std::hash<uint64_t>{}(
+        (static_cast<uint64_t>(item.production) << 32) | item.dot_position);
   }
 };
 
 template <> struct hash<slr::Production> {
   size_t operator()(const slr::Production &prod) const noexcept {
-    size_t h = std::hash<std::string>{}(prod.left);
+    size_t h = prod.left;
     for (const auto &symbol : prod.right) {
       h ^= std::hash<slr::SLRSymbol>{}(symbol) + 0x9e3779b9 + (h << 6) +
            (h >> 2);
@@ -147,16 +323,23 @@ struct ASTNode {
   SLRSymbol symbol;
   std::vector<ASTNode> children;
   std::optional<Production> production;
+  // 词法记号叶子识别到的文本，不放入全局符号表；为空时取符号名
+  std::string text;
   ASTNode(SLRSymbol symbol, std::optional<Production> production = std::nullopt)
       : symbol(symbol), production(production) {}
   ASTNode(SLRSymbol symbol, std::vector<ASTNode> children,
           std::optional<Production> production = std::nullopt)
       : symbol(symbol), children(children), production(production) {}
+  ASTNode(SLRSymbol symbol, std::string text)
+      : symbol(symbol), text(std::move(text)) {}
   void add_child(ASTNode child) { children.push_back(child); }
+  const std::string &value() const {
+    return text.empty() ? symbol.value() : text;
+  }
   std::string to_json() const;
   std::string to_string() const {
     std::stringstream ss;
-    ss << symbol.to_string();
+    ss << (text.empty() ? symbol.to_string() : "'" + text + "'");
     if (!children.empty()) {
       ss << "(";
       for (size_t i = 0; i < children.size(); i++) {
@@ -175,18 +358,25 @@ struct CSTNode {
   SLRSymbol symbol;
   std::vector<CSTNode> children;
   std::optional<Production> production;
+  // 词法记号叶子识别到的文本，不放入全局符号表；为空时取符号名
+  std::string text;
 
   CSTNode(SLRSymbol symbol, std::optional<Production> production = std::nullopt)
       : symbol(symbol), production(production) {}
   CSTNode(SLRSymbol symbol, std::vector<CSTNode> children,
           std::optional<Production> production = std::nullopt)
       : symbol(symbol), children(children), production(production) {}
+  CSTNode(SLRSymbol symbol, std::string text)
+      : symbol(symbol), text(std::move(text)) {}
   void add_child(CSTNode child) { children.push_back(child); }
+  const std::string &value() const {
+    return text.empty() ? symbol.value() : text;
+  }
   ASTNode to_ast() const;
   std::string to_json() const;
   std::string to_string() const {
     std::stringstream ss;
-    ss << symbol.to_string();
+    ss << (text.empty() ? symbol.to_string() : "'" + text + "'");
     if (!children.empty()) {
       ss << "(";
       for (size_t i = 0; i < children.size(); i++) {
@@ -215,18 +405,119 @@ struct Action {
   std::string to_string() const;
 };
 
+// 行位移（comb）压缩的二维表，没有显式存放的位置取该行的默认值
+// 内容相同的行共用一个位移，不同的行位移互不相同，因此 check 只需记录列号
+struct CombTable {
+  // 行内显式存放的 (列, 值)，按列排序
+  using Row = std::vector<std::pair<uint32_t, int16_t>>;
+
+  std::vector<int32_t> base;     // 行 -> 位移
+  std::vector<int16_t> defaults; // 行 -> 默认值
+  std::vector<int16_t> values;
+  std::vector<int16_t> check; // 位置上的值所属的列，空位为 -1
+
+  int16_t at(size_t row, size_t column) const {
+    size_t i = static_cast<size_t>(base[row]) + column;
+    return check[i] == static_cast<int16_t>(column) ? values[i]
+                                                    : defaults[row];
+  }
+
+  // 所有列号须小于 column_count
+  static CombTable build(const std::vector<Row> &rows,
+                         std::vector<int16_t> defaults, size_t column_count);
+
+  size_t bytes() const {
+    return base.size() * sizeof(int32_t) +
+           (defaults.size() + values.size() + check.size()) * sizeof(int16_t);
+  }
+};
+
+// 解析时使用的紧凑分析表
+// 在所有状态中动作都相同的终结符归为一类，ACTION 的列为终结符类
+// ACTION：状态 × 终结符类；正数为移进的目标状态，-(p+1) 为按产生式 p 归约，
+// 其中 -1 即归约增广产生式，表示接受；0 为出错
+// 只有一个归约动作的一致状态以该归约为默认值，不再存放显式项，
+// 解析时不看向前看符号直接归约；其余状态的默认值为出错
+// GOTO：非终结符下标 × 状态 -> 目标状态，每个非终结符以最常见的目标为默认值
+struct ParseTables {
+  static constexpr int16_t ERROR = 0;
+  static constexpr int16_t ACCEPT = -1;
+
+  static int16_t shift(int state) { return static_cast<int16_t>(state); }
+  static int16_t reduce(uint32_t production) {
+    return static_cast<int16_t>(-static_cast<int32_t>(production) - 1);
+  }
+  static uint32_t reduced_production(int16_t action) {
+    return static_cast<uint32_t>(-action - 1);
+  }
+
+  CombTable action;
+  CombTable gotos;
+  // 不是文法终结符的输入所属的类，ACTION 中没有这一列
+  static constexpr uint16_t NO_CLASS = UINT16_MAX;
+
+  // 终结符下标 -> 终结符类
+  std::vector<uint16_t> terminal_class;
+  // 字节 -> 以该单字节为文本的终结符所属的类，供字符模式下的普通字符使用
+  std::vector<uint16_t> byte_class;
+  size_t class_count = 0;
+
+  uint16_t class_of(size_t terminal) const {
+    return terminal < terminal_class.size() ? terminal_class[terminal]
+                                            : NO_CLASS;
+  }
+
+  // 一致状态的默认归约，其余状态为 ERROR
+  int16_t default_action(size_t state) const { return action.defaults[state]; }
+
+  int16_t action_at(size_t state, uint16_t terminal_class) const {
+    return terminal_class < class_count ? action.at(state, terminal_class)
+                                        : ERROR;
+  }
+
+  size_t bytes() const {
+    return action.bytes() + gotos.bytes() +
+           (terminal_class.size() + byte_class.size()) * sizeof(uint16_t);
+  }
+};
+
+// 分析表的构造方法，两者的表格式相同
+enum class ParserMode {
+  SLR1,  // 归约的向前看取左部的FOLLOW集合
+  LALR1, // 在LR(0)自动机上按 DeRemer–Pennello 的关系传播向前看
+};
+
+class ParserCache;
+
 // SLR1解析器类
 class SLR1Parser {
+  // 分析表缓存直接保存与恢复解析器的内部表
+  friend class ParserCache;
+
 private:
   grammar::Grammar grammar;
-  std::string start_symbol;
-  std::string augmented_start_symbol;
+  grammar::SymbolId start_symbol = 0;
+  grammar::SymbolId augmented_start_symbol = 0;
+
+  // 扁平文法，产生式与语法树引用其中的存储，解析器的副本之间共享
+  std::shared_ptr<const CompiledGrammar> compiled;
+
+  // 剪除无用符号之后对扁平文法的分析
+  GrammarAnalysis analysis;
 
-  // 增广文法的产生式
+  // 增广文法的产生式，下标与扁平文法中的编号一致
   std::vector<Production> productions;
 
-  // 项目集族
-  std::vector<std::unordered_set<LR0Item>> item_sets;
+  // 终结符编号 -> 符号，编号与 Grammar::extract_terminals 的下标一致
+  std::vector<SLRSymbol> terminal_symbols;
+
+  // LR(0) 自动机，每个状态只保存排好序的核心项目，闭包在需要时计算
+  std::vector<std::vector<LR0Item>> kernels;
+  // 状态 -> (符号, 目标状态)，按符号编号排序
+  std::vector<std::vector<std::pair<SLRSymbol, int>>> transitions;
+  // 状态 -> 点在末尾的项目的产生式编号
+  std::vector<std::vector<uint32_t>> reductions;
+  size_t state_count = 0;
 
   // GOTO表：状态 x 符号 -> 状态
   std::unordered_map<int, std::unordered_map<SLRSymbol, int>> goto_table;
@@ -234,21 +525,57 @@ private:
   // ACTION表：状态 x 终结符 -> 动作
   std::unordered_map<int, std::unordered_map<SLRSymbol, Action>> action_table;
 
-  // FIRST集合：非终结符 -> 终结符集合
-  std::unordered_map<std::string, std::unordered_set<SLRSymbol>> first_sets;
+  // 由上面两张表压缩得到，解析主循环只查这里
+  ParseTables tables;
+
+  // FIRST集合：非终结符下标 -> 终结符下标的位集
+  std::vector<Bitset> first_sets;
+
+  // FOLLOW集合：非终结符下标 -> 终结符下标的位集
+  std::vector<Bitset> follow_sets;
+
+  // LALR(1) 的向前看：状态 -> 与 reductions 一一对应的终结符下标位集
+  std::vector<std::vector<Bitset>> lookaheads;
+
+  ParserMode mode = ParserMode::SLR1;
+
+  // 非终结符下标 -> 它出现在点后时闭包加入的全部产生式（点在开头）
+  // 即沿左角关系可到达的非终结符的产生式，所有状态共用
+  std::vector<Bitset> closure_sets;
+
+  // 计算 closure_sets
+  void compute_closure_sets();
+
+  // 计算核心项目的闭包，结果按项目排序；scratch 为按产生式编号的临时位集
+  void closure(const std::vector<LR0Item> &kernel, std::vector<LR0Item> &items,
+               Bitset &scratch) const;
+
+  // 每个线程至少分到的产生式数，文法较小时顺序构建
+  static constexpr size_t MIN_PRODUCTIONS_PER_THREAD = 64;
 
-  // FOLLOW集合：非终结符 -> 终结符集合
-  std::unordered_map<std::string, std::unordered_set<SLRSymbol>> follow_sets;
+  // 转移符号与前移后的目标核心
+  using Successor = std::pair<SLRSymbol, std::vector<LR0Item>>;
 
-  // 计算项目的闭包
-  std::unordered_set<LR0Item> closure(const std::unordered_set<LR0Item> &items);
+  // 展开状态时复用的临时存储，每个线程一份
+  struct StateScratch {
+    std::vector<LR0Item> items;
+    Bitset added;
+    std::vector<std::pair<SLRSymbol, LR0Item>> moves;
 
-  // 计算GOTO函数
-  std::unordered_set<LR0Item> go_to(const std::unordered_set<LR0Item> &items,
-                                    const SLRSymbol &symbol);
+    explicit StateScratch(size_t production_count) : added(production_count) {}
+  };
 
-  // 构建项目集族
-  void build_item_sets();
+  // 计算状态的全部后继核心与可归约的产生式
+  void expand_state(const std::vector<LR0Item> &kernel, StateScratch &scratch,
+                    std::vector<Successor> &successors,
+                    std::vector<uint32_t> &complete) const;
+
+  // 构建项目集族，thread_count 为 0 时使用硬件线程数
+  void build_item_sets(size_t thread_count);
+
+  // 多线程构建：工作窃取展开状态，分片的散列表查找核心，
+  // 最后按顺序构建的编号重排
+  void build_item_sets_parallel(size_t thread_count);
 
   // 计算FIRST集合
   void compute_first_sets();
@@ -256,35 +583,49 @@ private:
   // 计算FOLLOW集合
   void compute_follow_sets();
 
-  // 构建SLR分析表
+  // 计算LALR(1)的向前看，需要先构建项目集族
+  void compute_lalr_lookaheads();
+
+  // 构建分析表
   void build_tables();
-  void handle_reduce_action(size_t i, const LR0Item &item);
+
+  // 将分析表压缩为 tables，状态数或产生式数超出 int16 范围时失败
+  bool compress_tables();
+  void handle_reduce_action(size_t i, uint32_t production,
+                            const Bitset &lookahead);
   void handle_accept_action(size_t i);
   void handle_shift_action(size_t i, const SLRSymbol &symbol, int next_state);
 
   // 将语法规则转换为增广文法
-  void initialize_augment_grammar();
-
-  // 获取符号的FIRST集合
-  std::unordered_set<SLRSymbol> get_first(const SLRSymbol &symbol);
+  // 开始符号不能推导出终结符串时失败
+  bool initialize_augment_grammar();
 
-  // 获取符号序列的FIRST集合
-  std::unordered_set<SLRSymbol>
-  get_first_of_sequence(const std::vector<SLRSymbol> &symbols,
-                        size_t start_pos = 0);
+  // 按位置取输入终结符类的解析主循环，不是文法终结符时为 ParseTables::NO_CLASS
+  // leaf_at 给出移进时放入语法树的叶子，
+  // symbol_at 给出输入符号的显示文本，与 describe 一样只在报错时调用
+  template <typename TerminalAt, typename SymbolAt, typename LeafAt,
+            typename Describe>
+  bool parse_symbols(TerminalAt terminal_at, SymbolAt symbol_at,
+                     LeafAt leaf_at, Describe describe, CSTNode &root);
 
 public:
   // 构造函数
   SLR1Parser(const grammar::Grammar &grammar) : grammar(grammar) {}
 
-  // 构建解析表，指定开始符号
-  bool build_parse_table(const std::string &start_symbol);
+  // 构建解析表，指定开始符号与构造方法
+  // thread_count 为构造LR(0)自动机的线程数，0 为硬件线程数，结果与线程数无关
+  bool build_parse_table(const std::string &start_symbol,
+                         ParserMode mode = ParserMode::SLR1,
+                         size_t thread_count = 0);
 
   // 解析输入符号序列
   bool parse(const std::vector<SLRSymbol> &input, CSTNode &root);
 
+  // 直接解析token流，终结符编号由 terminal_symbols 映射为符号
+  bool parse(const tokenizer::TokenStream &input, CSTNode &root);
+
   // 执行移进操作
-  void perform_shift(int next_state, const SLRSymbol &symbol,
+  void perform_shift(int next_state, CSTNode leaf,
                      std::stack<int> &state_stack,
                      std::stack<CSTNode> &symbol_stack, size_t &input_pos);
 
@@ -299,6 +640,11 @@ public:
   // 处理语法错误
   bool handle_error(int state, const SLRSymbol &symbol, size_t input_pos);
 
+  // 处理语法错误，symbol 为出错输入符号的显示文本，
+  // position 为出错位置的描述（如行号与列号）
+  bool handle_error(int state, const std::string &symbol,
+                    const std::string &position);
+
   // 获取ACTION表
   const std::unordered_map<int, std::unordered_map<SLRSymbol, Action>> &
   get_action_table() const {
@@ -311,9 +657,24 @@ public:
     return goto_table;
   }
 
+  // 获取紧凑分析表
+  const ParseTables &get_parse_tables() const { return tables; }
+
   // 获取产生式
   const std::vector<Production> &get_productions() const { return productions; }
 
+  // 获取扁平文法，构建解析表之前为空
+  const CompiledGrammar *get_compiled_grammar() const { return compiled.get(); }
+
+  // 获取文法分析结果
+  const GrammarAnalysis &get_analysis() const { return analysis; }
+
+  // 状态数
+  size_t get_state_count() const { return state_count; }
+
+  // 分析表建成后释放项目集与转移，之后导出的JSON中项目集为空
+  void release_item_sets();
+
   // 打印分析表
   void print_parse_table() const;
 
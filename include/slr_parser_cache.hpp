@@ -0,0 +1,103 @@
+#ifndef SLR_PARSER_CACHE_HPP
+#define SLR_PARSER_CACHE_HPP
+
+#include "slr_parser.hpp"
+#include "tokenizer.hpp"
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace slr {
+
+// 缓存格式的版本号，布局改变时递增，使旧的缓存失效
+constexpr uint32_t PARSER_CACHE_VERSION = 2;
+
+// 分析表缓存：只读映射的二进制文件，保存符号名、扁平文法、AST规则、
+// 紧凑分析表与词法自动机。以语法文本、开始符号与构造方法的散列为键，
+// 键或版本不一致时视为未命中，由调用方重新构建后写入
+// 文件头之后由若干数组依次组成，每个数组以元素个数开头并按8字节对齐
+// 文件头记录其后全部内容的散列，打开时先校验散列再检查各数组的范围
+class ParserCache {
+public:
+  // 缓存中的符号：符号名在名字表中的下标与符号类型
+  struct Symbol {
+    uint32_t name;
+    uint32_t type;
+  };
+
+  // AST规则与语义动作在各自数组中的区间
+  struct Rule {
+    uint32_t children_begin;
+    uint32_t children_end;
+    uint32_t action_begin;
+    uint32_t action_end;
+    uint32_t do_flatten;
+    uint32_t use_all_children;
+  };
+
+  // 映射中各数组的视图，打开时校验
+  struct Image {
+    // 名字 i 为 names 中的 [name_offsets[i], name_offsets[i + 1])
+    std::span<const uint32_t> name_offsets;
+    std::span<const char> names;
+    std::span<const Symbol> symbols;
+    std::span<const CompiledGrammar::ProductionEntry> productions;
+    std::span<const Rule> rules;
+    std::span<const uint64_t> rule_children;
+    std::span<const char> rule_actions;
+    std::span<const Symbol> terminals;
+    std::span<const uint32_t> non_terminals;
+    std::span<const uint32_t> production_begin;
+    uint64_t state_count = 0;
+    uint64_t class_count = 0;
+    std::span<const int32_t> action_base, goto_base;
+    std::span<const int16_t> action_defaults, action_values, action_check;
+    std::span<const int16_t> goto_defaults, goto_values, goto_check;
+    std::span<const uint16_t> terminal_class;
+    std::span<const uint16_t> byte_class;
+    uint64_t lexer_states = 0;
+    uint64_t lexer_classes = 0;
+    std::span<const uint8_t> byte_classes;
+    std::span<const int32_t> transitions;
+    std::span<const tokenizer::LexerAutomaton::Accept> accepts;
+  };
+
+private:
+  const char *data = nullptr;
+  size_t size = 0;
+  Image image;
+
+  void release();
+
+public:
+  ParserCache() = default;
+  ParserCache(const ParserCache &) = delete;
+  ParserCache &operator=(const ParserCache &) = delete;
+  ParserCache(ParserCache &&other) noexcept;
+  ParserCache &operator=(ParserCache &&other) noexcept;
+  ~ParserCache() { release(); }
+
+  // 缓存的键：语法文本、开始符号、构造方法、格式版本与程序构建标识的散列
+  static uint64_t key(std::string_view grammar_text,
+                      std::string_view start_symbol, ParserMode mode);
+
+  // 映射并校验缓存，文件不存在、键或版本不一致、散列不符或内容越界时返回空
+  static std::optional<ParserCache> open(const std::string &filename,
+                                         uint64_t key);
+
+  // 先写入临时文件再改名，失败时保留原有的缓存
+  static bool write(const std::string &filename, uint64_t key,
+                    const SLR1Parser &parser, const tokenizer::Lexer &lexer);
+
+  // 由缓存恢复解析器，只有紧凑分析表，没有项目集与散列表形式的分析表
+  SLR1Parser parser() const;
+
+  // 由缓存恢复词法规则，自动机直接引用映射，缓存需比词法规则活得更久
+  tokenizer::Lexer lexer() const;
+};
+
+} // namespace slr
+
+#endif
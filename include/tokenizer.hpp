@@ -2,10 +2,14 @@
 #define TOKENIZER_HPP
 
 #include "grammar_parser.hpp"
+#include "tokenizer_simd.hpp"
+#include <array>
+#include <cstdint>
+#include <iostream>
 #include <memory>
 #include <optional>
-#include <sstream>
 #include <string>
+#include <string_view>
 #include <unordered_set>
 #include <vector>
 
@@ -14,62 +18,739 @@ namespace tokenizer {
 struct Token {
 private:
   std::string value;
-  grammar::Terminal terminal;
+  // 字符模式下的普通字符与错误token不对应文法终结符，为空
+  std::optional<grammar::Terminal> terminal;
 
 public:
-  Token(std::string value, grammar::Terminal terminal)
+  Token(std::string value, std::optional<grammar::Terminal> terminal)
       : value(std::move(value)), terminal(std::move(terminal)) {}
 
   const std::string &get_value() const { return value; }
-  const grammar::Terminal &get_terminal() const { return terminal; }
+  const std::optional<grammar::Terminal> &get_terminal() const {
+    return terminal;
+  }
 
   std::string to_string() const;
 };
 
-struct Tokenizer {
+// 词法表格式的版本号，自动机的构造方式改变时递增，使旧的生成表失效
+constexpr uint32_t LEXER_TABLES_VERSION = 1;
+
+// 词法自动机：由字面终结符的字典树与各词法记号的 NFA 子集构造而成，
+// 按字节转移的确定性自动机，一次扫描即可得到所有前缀匹配
+// 转移表按字节类压缩：转移完全相同的字节共用一列
+// 表可以在运行时构建，也可以直接引用 tools/lexer_gen 生成的静态表
+struct LexerAutomaton {
+  static constexpr int32_t NO_STATE = -1;
+  static constexpr int32_t NO_TERMINAL = -1;
+
+  struct Accept {
+    int32_t terminal = NO_TERMINAL; // 接受的字面终结符下标
+    bool keyword_like = false;      // 全为字母且长度大于1，需要检查标识符边界
+    bool char_mode_ok = false;      // 字符模式下可用：单字符或以反斜杠开头
+    bool helper = false;            // 只出现在词法辅助规则中，让位于记号
+    int32_t token = NO_TERMINAL;    // 接受的记号终结符下标，多个时取最小
+  };
+
+  // 字节 -> 字节类，共256项
+  const uint8_t *byte_classes = nullptr;
+  // 状态 x 字节类 -> 状态，按行平铺
+  const int32_t *transitions = nullptr;
+  // 每个状态的接受信息
+  const Accept *accepts = nullptr;
+  size_t class_count = 0;
+  size_t states = 0;
+
+  LexerAutomaton() = default;
+  LexerAutomaton(const std::vector<grammar::Terminal> &terminals,
+                 const grammar::LexicalPromotion &promotion);
+
+  // 引用外部的静态表，表需比自动机活得更久
+  LexerAutomaton(size_t states, size_t class_count,
+                 const uint8_t *byte_classes, const int32_t *transitions,
+                 const Accept *accepts)
+      : byte_classes(byte_classes), transitions(transitions),
+        accepts(accepts), class_count(class_count), states(states) {}
+
+  int32_t step(int32_t state, unsigned char byte) const {
+    return transitions[static_cast<size_t>(state) * class_count +
+                       byte_classes[byte]];
+  }
+
+  size_t state_count() const { return states; }
+
+private:
+  // 运行时构建的表，复制自动机时共享
+  struct Storage {
+    std::vector<uint8_t> byte_classes;
+    std::vector<int32_t> transitions;
+    std::vector<Accept> accepts;
+  };
+  std::shared_ptr<const Storage> storage;
+};
+
+// 输入源：内存映射的文件或持有的字符串，词法分析直接在其上原地进行
+class SourceBuffer {
 private:
+  std::string owned;
+  const char *mapped = nullptr;
+  size_t mapped_size = 0;
+
+  void release();
+
+public:
+  SourceBuffer() = default;
+  explicit SourceBuffer(std::string text) : owned(std::move(text)) {}
+  SourceBuffer(const SourceBuffer &) = delete;
+  SourceBuffer &operator=(const SourceBuffer &) = delete;
+  SourceBuffer(SourceBuffer &&other) noexcept;
+  SourceBuffer &operator=(SourceBuffer &&other) noexcept;
+  ~SourceBuffer() { release(); }
+
+  // 只读映射整个文件
+  static std::optional<SourceBuffer> map_file(const std::string &filename);
+
+  std::string_view view() const {
+    return mapped != nullptr ? std::string_view(mapped, mapped_size)
+                             : std::string_view(owned);
+  }
+  size_t size() const { return view().size(); }
+
+  // 把 [offset, offset + length) 替换为 text，映射的文件会先复制为持有的字符串
+  void replace(size_t offset, size_t length, std::string_view text);
+};
+
+// 零拷贝token：指向输入源的一段切片
+struct TokenView {
+  static constexpr uint16_t UNKNOWN_TERMINAL = UINT16_MAX;
+  static constexpr uint16_t ERROR_TERMINAL = UINT16_MAX - 1;
+
+  // 终结符编号，字符模式下的普通字符为 UNKNOWN_TERMINAL
+  // 容错模式下无法识别的字符为 ERROR_TERMINAL
+  uint16_t terminal_id;
+  size_t offset;        // 在输入源中的起始偏移
+  uint32_t length;      // 在输入源中占用的字节数
+};
+
+// 结构数组形式的token流：终结符编号、偏移与长度分别连续存放，每个token 10字节
+// 另有1位记录token开始前的字符模式，供增量分析寻找重新开始的位置
+// 偏移与长度为32位，输入源不能超过4GB
+struct TokenStream {
+  std::string_view source; // token切片所指向的输入源，需比token流活得更久
+  std::vector<uint16_t> terminal_ids;
+  std::vector<uint32_t> offsets;
+  std::vector<uint32_t> lengths;
+  std::vector<bool> char_modes;
+
+  size_t size() const { return terminal_ids.size(); }
+  bool empty() const { return terminal_ids.empty(); }
+
+  void reserve(size_t count) {
+    terminal_ids.reserve(count);
+    offsets.reserve(count);
+    lengths.reserve(count);
+    char_modes.reserve(count);
+  }
+
+  // char_mode 为识别该token之前的字符模式
+  void push_back(const TokenView &view, bool char_mode);
+
+  // 追加 other 中 [begin, end) 的token
+  void append(const TokenStream &other, size_t begin, size_t end);
+
+  // 把 [begin, end) 的token替换为 replacement，之后的token偏移加上 delta
+  void splice(size_t begin, size_t end, const TokenStream &replacement,
+              int64_t delta);
+
+  TokenView at(size_t i) const {
+    return TokenView{terminal_ids[i], offsets[i], lengths[i]};
+  }
+
+  std::string_view text(size_t i) const {
+    return source.substr(offsets[i], lengths[i]);
+  }
+};
+
+// pos 所在行是否为以//开头的注释行
+bool in_comment_line(std::string_view input, size_t pos);
+
+// 去掉记号原始文本中的换行符与注释行，得到其在文法中的文本
+std::string strip_layout(std::string_view text);
+
+// 源码位置，行号与列号都从1开始，列号按字节计
+struct SourceLocation {
+  size_t line;
+  size_t column;
+};
+
+// 行首偏移表：每行第一个字节在输入中的偏移，按偏移二分查找行号
+// token 只记录偏移，需要报告位置时再查表
+struct LineIndex {
+  std::vector<size_t> line_starts;
+
+  explicit LineIndex(std::string_view source);
+
+  SourceLocation locate(size_t offset) const;
+};
+
+// 一次文本编辑：把 [offset, offset + deleted) 替换为 inserted
+struct TextEdit {
+  size_t offset;
+  size_t deleted;
+  std::string inserted;
+};
+
+// 字节分类标志，通过查表判断字符类别，不依赖区域设置
+enum ByteFlag : uint8_t {
+  BYTE_LETTER = 1 << 0,     // ASCII 字母
+  BYTE_DIGIT = 1 << 1,      // ASCII 数字
+  BYTE_IDENTIFIER = 1 << 2, // 字母、数字或下划线
+  BYTE_NON_ASCII = 1 << 3,  // 最高位为1，属于多字节 UTF-8 序列
+};
+
+constexpr std::array<uint8_t, 256> BYTE_FLAGS = [] {
+  std::array<uint8_t, 256> flags{};
+  for (int c = 0; c < 256; c++) {
+    if (('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z')) {
+      flags[c] |= BYTE_LETTER | BYTE_IDENTIFIER;
+    }
+    if ('0' <= c && c <= '9') {
+      flags[c] |= BYTE_DIGIT | BYTE_IDENTIFIER;
+    }
+    if (c == '_') {
+      flags[c] |= BYTE_IDENTIFIER;
+    }
+    if (c >= 0x80) {
+      flags[c] |= BYTE_NON_ASCII;
+    }
+  }
+  return flags;
+}();
+
+inline bool has_byte_flag(char c, ByteFlag flag) {
+  return (BYTE_FLAGS[static_cast<unsigned char>(c)] & flag) != 0;
+}
+
+// 标识符字符：字母、数字或下划线
+inline bool is_identifier_char(char c) {
+  return has_byte_flag(c, BYTE_IDENTIFIER);
+}
+
+// 连续内存输入的读取器
+struct BufferReader {
+  std::string_view input;
+
+  bool available(size_t pos) const { return pos < input.size(); }
+  char at(size_t pos) const { return input[pos]; }
+
+  // 从 pos 开始查找换行符，找不到时返回输入末尾
+  // commit 为真时表示已扫描的部分不再需要
+  size_t find_newline(size_t pos, bool) const {
+    return pos + simd::find_byte(input.data() + pos, input.size() - pos, '\n');
+  }
+
+  // 从 pos 开始跳过空格与换行符，返回第一个其它字节的位置或输入末尾
+  size_t skip_blanks(size_t pos) const {
+    return pos + simd::find_non_blank(input.data() + pos, input.size() - pos);
+  }
+
+  // 标记 pos 之前的输入不再需要
+  void commit(size_t) {}
+};
+
+// 词法错误的种类
+enum class LexErrorKind {
+  UNEXPECTED_CHARACTER, // 无法匹配任何终结符
+  INVALID_UTF8,         // UTF-8 模式下的非法编码序列
+};
+
+// 词法错误：无法匹配任何终结符的位置
+struct LexDiagnostic {
+  size_t offset;     // 在输入中的偏移
+  char byte;         // 出错的字节
+  bool in_char_mode; // 出错时是否处于字符模式
+  LexErrorKind kind = LexErrorKind::UNEXPECTED_CHARACTER;
+  uint32_t length = 1; // 错误token覆盖的字节数
+
+  std::string describe() const;
+};
+
+// 一次匹配的结果
+enum class ScanStatus {
+  TOKEN,      // 识别到一个token
+  END,        // 输入已处理完
+  UNEXPECTED, // 当前位置无法匹配任何终结符
+};
+
+// 词法规则：终结符表与词法自动机，构建后只读，可被多个分析器共享
+// 匹配过程通过读取器访问输入，读取器需提供
+// available/at/find_newline/skip_blanks/commit
+struct Lexer {
   std::vector<grammar::Terminal> terminals;
-  std::string input;
-  size_t position;
-  bool in_char_mode = false;
+  LexerAutomaton automaton;
+  uint16_t quote_terminal = TokenView::UNKNOWN_TERMINAL; // 单引号终结符编号
+  // 是否存在包含空格的终结符或记号，为假时空格一定是token边界
+  bool tokens_span_spaces = false;
+  // 字符模式下一定作为普通字符的字节：不是空白、单引号或注释的开头，
+  // 也不能开始任何字符模式下可用的终结符
+  std::array<bool, 256> char_mode_plain{};
+  // UTF-8 模式：字符模式下一个多字节字符作为一个token，非法序列单独报错
+  // 关闭时按字节处理输入
+  bool utf8 = false;
+
+private:
+  // 检查终结符个数，并求出 quote_terminal、tokens_span_spaces
+  // 与 char_mode_plain
+  void init();
+
+public:
+  // 终结符编号即其在 terminals 中的下标，应与 Grammar::extract_terminals 一致
+  // promotion 为 Grammar::promote_regular_nonterminals 的结果
+  Lexer(const std::vector<grammar::Terminal> &terminals,
+        const grammar::LexicalPromotion &promotion = {});
+
+  // 使用已经构建好的自动机，例如 tools/lexer_gen 生成的静态表
+  Lexer(const std::vector<grammar::Terminal> &terminals,
+        LexerAutomaton automaton);
+
+  // 使用编译进程序的生成表（include/lexer_tables.hpp）
+  // 生成表与运行时构建的表一样通过指针访问，扫描循环并不针对生成表特化
+  // 表与语法文本散列、表格式版本或终结符表不一致时返回空，
+  // 调用方应回退到运行时构建
+  static std::optional<Lexer>
+  from_generated(const std::vector<grammar::Terminal> &terminals,
+                 uint64_t grammar_hash);
+
+  // 字符模式下 c 是否一定作为普通字符，无需经过自动机
+  bool is_plain_char(char c) const {
+    return char_mode_plain[static_cast<unsigned char>(c)];
+  }
+
+  // 原地跳过换行符以及以//开头的注释行，返回下一个有效字符的位置
+  template <typename Reader>
+  size_t skip_layout(Reader &reader, size_t pos) const;
+
+  // 从 pos 开始的合法 UTF-8 序列的字节数，非法时返回 0
+  template <typename Reader>
+  size_t code_point_length(Reader &reader, size_t pos) const;
+
+  // 从 position 开始识别一个token，并推进 position 与字符模式
+  // 无法匹配时输出错误信息并抛出异常
+  template <typename Reader>
+  std::optional<TokenView> scan(Reader &reader, size_t &position,
+                                bool &in_char_mode) const;
+
+  // 与 scan 相同但不报错，无法匹配时 position 停在出错的字符上
+  template <typename Reader>
+  ScanStatus match(Reader &reader, size_t &position, bool &in_char_mode,
+                   TokenView &view) const;
+
+  // 容错的 scan：无法匹配时记录诊断信息并返回错误token，不抛出异常
+  template <typename Reader>
+  std::optional<TokenView>
+  scan_tolerant(Reader &reader, size_t &position, bool &in_char_mode,
+                std::vector<LexDiagnostic> &diagnostics) const;
+
+  // match 返回 UNEXPECTED 后调用：记录诊断信息，跳过出错的字符并返回错误token
+  template <typename Reader>
+  TokenView recover(Reader &reader, size_t &position, bool in_char_mode,
+                    std::vector<LexDiagnostic> &diagnostics) const;
+
+  // 将切片转换为持有字符串的token，text 为切片对应的原始文本
+  Token to_token(const TokenView &view, std::string_view text) const;
+};
+
+template <typename Reader>
+size_t Lexer::skip_layout(Reader &reader, size_t pos) const {
+  while (reader.available(pos)) {
+    if (reader.at(pos) == '\n') {
+      pos++;
+      continue;
+    }
+    // 跳过以//开头的注释行
+    bool line_start = pos == 0 || reader.at(pos - 1) == '\n';
+    if (line_start && reader.at(pos) == '/' && reader.available(pos + 1) &&
+        reader.at(pos + 1) == '/') {
+      pos = reader.find_newline(pos, false);
+      continue;
+    }
+    break;
+  }
+  return pos;
+}
+
+template <typename Reader>
+size_t Lexer::code_point_length(Reader &reader, size_t pos) const {
+  unsigned char bytes[4];
+  size_t count = 0;
+  while (count < 4 && reader.available(pos + count)) {
+    bytes[count] = static_cast<unsigned char>(reader.at(pos + count));
+    count++;
+  }
+  return simd::utf8_sequence_length(bytes, count);
+}
+
+template <typename Reader>
+std::optional<TokenView> Lexer::scan(Reader &reader, size_t &position,
+                                     bool &in_char_mode) const {
+  TokenView view{};
+  switch (match(reader, position, in_char_mode, view)) {
+  case ScanStatus::TOKEN:
+    return view;
+  case ScanStatus::END:
+    return std::nullopt;
+  case ScanStatus::UNEXPECTED:
+    break;
+  }
+
+  // 如果没有匹配到任何终结符，则报错
+  if (utf8 && has_byte_flag(reader.at(position), BYTE_NON_ASCII) &&
+      code_point_length(reader, position) == 0) {
+    std::cerr << "Error: Invalid UTF-8 sequence at position " << position
+              << std::endl;
+    throw std::runtime_error("Error: Invalid UTF-8 sequence");
+  }
+  std::cerr << "Error: Unexpected character '" << reader.at(position)
+            << "' at position " << position << std::endl;
+  std::cerr << "Now string mode is " << in_char_mode << std::endl;
+  throw std::runtime_error("Error: Unexpected character");
+}
+
+template <typename Reader>
+std::optional<TokenView>
+Lexer::scan_tolerant(Reader &reader, size_t &position, bool &in_char_mode,
+                     std::vector<LexDiagnostic> &diagnostics) const {
+  TokenView view{};
+  switch (match(reader, position, in_char_mode, view)) {
+  case ScanStatus::TOKEN:
+    return view;
+  case ScanStatus::END:
+    return std::nullopt;
+  case ScanStatus::UNEXPECTED:
+    break;
+  }
+  return recover(reader, position, in_char_mode, diagnostics);
+}
+
+template <typename Reader>
+TokenView Lexer::recover(Reader &reader, size_t &position, bool in_char_mode,
+                         std::vector<LexDiagnostic> &diagnostics) const {
+  // 跳过出错的字节及其后的 UTF-8 后续字节，使一个多字节字符只报一次错
+  size_t start = position;
+  LexErrorKind kind = LexErrorKind::UNEXPECTED_CHARACTER;
+  if (utf8 && has_byte_flag(reader.at(start), BYTE_NON_ASCII) &&
+      code_point_length(reader, start) == 0) {
+    kind = LexErrorKind::INVALID_UTF8;
+  }
+  position++;
+  while (reader.available(position) &&
+         (static_cast<unsigned char>(reader.at(position)) & 0xC0) == 0x80) {
+    position++;
+  }
+  auto length = static_cast<uint32_t>(position - start);
+  diagnostics.push_back(
+      LexDiagnostic{start, reader.at(start), in_char_mode, kind, length});
+  return TokenView{TokenView::ERROR_TERMINAL, start, length};
+}
 
-  // 按照终结符长度排序（从长到短）
-  void sort_terminals();
+template <typename Reader>
+ScanStatus Lexer::match(Reader &reader, size_t &position, bool &in_char_mode,
+                        TokenView &view) const {
+  // 遇到空格、换行符或注释行时，跳过它们
+  while (true) {
+    position = reader.skip_blanks(position);
+    if (!reader.available(position)) {
+      break;
+    }
+    // 跳过以//开头的注释行
+    bool line_start = position == 0 || reader.at(position - 1) == '\n';
+    if (line_start && reader.at(position) == '/' &&
+        reader.available(position + 1) && reader.at(position + 1) == '/') {
+      position = reader.find_newline(position, true);
+      continue;
+    }
+    break;
+  }
+  reader.commit(position);
+
+  // 如果已经处理完所有输入，则返回空
+  if (!reader.available(position)) {
+    return ScanStatus::END;
+  }
+
+  size_t start = position;
 
-  // 预处理输入文本：去除注释和换行符
-  std::string preprocess_input(const std::string &input) {
-    std::stringstream result;
-    std::istringstream stream(input);
-    std::string line;
+  // 检查是否遇到单引号
+  if (reader.at(position) == '\'') {
+    in_char_mode = !in_char_mode;
+    position++;
+    view = TokenView{quote_terminal, start, 1};
+    return ScanStatus::TOKEN;
+  }
+
+  // 沿自动机向前扫描一次，记录满足条件的最长匹配
+  int32_t matched = LexerAutomaton::NO_TERMINAL;
+  size_t matched_end = 0;
+  int32_t state = 0;
+  for (size_t pos = position; reader.available(pos);) {
+    state = automaton.step(state, static_cast<unsigned char>(reader.at(pos)));
+    if (state == LexerAutomaton::NO_STATE) {
+      break;
+    }
 
-    while (std::getline(stream, line)) {
-      // 跳过以//开头的注释行
-      if (line.substr(0, 2) != "//") {
-        result << line;
+    size_t next_pos = skip_layout(reader, pos + 1);
+    const LexerAutomaton::Accept &accept = automaton.accepts[state];
+    bool usable = false;
+    if (accept.terminal != LexerAutomaton::NO_TERMINAL) {
+      if (in_char_mode) {
+        // 在字符模式下，只匹配以反斜杠开头的terminal和单字符terminal
+        usable = accept.char_mode_ok;
+      } else if (accept.keyword_like) {
+        // 如果紧跟的下一个字符是字母/数字/下划线，说明是标识符，跳过
+        usable = !(reader.available(next_pos) &&
+                   is_identifier_char(reader.at(next_pos)));
+      } else {
+        usable = true;
       }
     }
+    // 同样长度时：关键字等字面终结符优先于记号，记号优先于词法辅助终结符
+    // 字符模式下不识别记号
+    if (usable && !accept.helper) {
+      matched = accept.terminal;
+      matched_end = pos + 1;
+    } else if (!in_char_mode && accept.token != LexerAutomaton::NO_TERMINAL) {
+      matched = accept.token;
+      matched_end = pos + 1;
+    } else if (usable) {
+      matched = accept.terminal;
+      matched_end = pos + 1;
+    }
+    pos = next_pos;
+  }
 
-    return result.str();
+  if (matched != LexerAutomaton::NO_TERMINAL) {
+    position = matched_end;
+    view = TokenView{static_cast<uint16_t>(matched), start,
+                     static_cast<uint32_t>(matched_end - start)};
+    return ScanStatus::TOKEN;
   }
 
+  if (in_char_mode) {
+    // 在字符模式下，如果没有匹配到特殊字符，则作为普通字符处理
+    // UTF-8 模式下一个多字节字符整体作为一个普通字符
+    size_t length = 1;
+    if (utf8 && has_byte_flag(reader.at(start), BYTE_NON_ASCII)) {
+      length = code_point_length(reader, start);
+      if (length == 0) {
+        return ScanStatus::UNEXPECTED;
+      }
+    }
+    position += length;
+    view = TokenView{TokenView::UNKNOWN_TERMINAL, start,
+                     static_cast<uint32_t>(length)};
+    return ScanStatus::TOKEN;
+  }
+
+  return ScanStatus::UNEXPECTED;
+}
+
+struct Tokenizer {
+private:
+  Lexer lexer;
+  SourceBuffer source;
+  size_t position;
+  bool in_char_mode = false;
+  bool error_tolerant = false;
+  std::vector<LexDiagnostic> diagnostics;
+  // 第一次查询位置时才建立，输入被编辑后作废
+  mutable std::unique_ptr<LineIndex> line_index;
+
+  // UTF-8 模式下整体校验输入中 [begin, end) 的部分，包括注释等被跳过的输入
+  // 非容错时遇到非法序列报错并抛出异常，容错时返回每个非法序列的诊断信息
+  std::vector<LexDiagnostic> check_utf8(size_t begin, size_t end) const;
+
+  // 把整体校验得到的诊断信息并入 diagnostics，结果按偏移排序
+  // 词法分析已在同一位置报告的非法序列不再重复记录
+  static void merge_diagnostics(std::vector<LexDiagnostic> &diagnostics,
+                                const std::vector<LexDiagnostic> &invalid);
+
 public:
+  // 终结符编号即其在 terminals 中的下标，应与 Grammar::extract_terminals 一致
   Tokenizer(const std::vector<grammar::Terminal> &terminals, std::string input)
-      : terminals(terminals), input(preprocess_input(std::move(input))),
-        position(0) {
-    sort_terminals();
-  }
+      : Tokenizer(terminals, SourceBuffer(std::move(input))) {}
+
+  Tokenizer(const std::vector<grammar::Terminal> &terminals,
+            SourceBuffer source)
+      : Tokenizer(Lexer(terminals), std::move(source)) {}
+
+  Tokenizer(Lexer lexer, SourceBuffer source);
 
   // 获取下一个token
   std::optional<Token> next_token();
 
+  // 获取下一个token的切片，不分配内存
+  std::optional<TokenView> next_view() {
+    BufferReader reader{source.view()};
+    if (error_tolerant) {
+      return lexer.scan_tolerant(reader, position, in_char_mode, diagnostics);
+    }
+    return lexer.scan(reader, position, in_char_mode);
+  }
+
+  // 容错模式：遇到无法识别的字符时记录诊断信息并产生错误token，而不是抛出异常
+  void set_error_tolerant(bool tolerant) { error_tolerant = tolerant; }
+
+  // UTF-8 模式，见 Lexer::utf8
+  // tokenize 会先整体校验输入，非容错时遇到非法序列直接报错，
+  // 容错时每个非法序列记录一条诊断信息，两种模式拒绝的输入相同
+  void set_utf8(bool enabled) { lexer.utf8 = enabled; }
+
+  // 容错模式下记录的全部词法错误，按偏移排序
+  const std::vector<LexDiagnostic> &get_diagnostics() const {
+    return diagnostics;
+  }
+
+  // 读取剩余全部输入，生成token流
+  TokenStream tokenize();
+
+  // 对输入源应用一次编辑，并只重新分析受影响的区间来更新 tokens
+  // tokens 必须是本分析器 tokenize 得到的完整token流，更新后指向新的输入源
+  void apply_edit(TokenStream &tokens, const TextEdit &edit);
+
+  // 按空格把剩余输入切分为至多 thread_count 块并行分析后拼接，
+  // 除第一块外每块从两种字符模式各分析一遍，不需要等待前一块的结果
+  // 结果与 tokenize 完全一致，thread_count 为 0 时使用硬件线程数
+  TokenStream tokenize_parallel(size_t thread_count = 0);
+
+  // 将切片转换为持有字符串的token
+  Token to_token(const TokenView &view) const {
+    return lexer.to_token(view, text(view));
+  }
+
+  // 切片在输入源中对应的原始文本
+  std::string_view text(const TokenView &view) const {
+    return source.view().substr(view.offset, view.length);
+  }
+
   // 检查是否已经处理完所有输入
-  bool is_end() const { return position >= input.size(); }
+  bool is_end() const {
+    BufferReader reader{source.view()};
+    return !reader.available(lexer.skip_layout(reader, position));
+  }
 
-  // 获取当前位置
+  // 获取当前位置（输入源中的偏移）
   size_t get_position() const { return position; }
 
+  // 输入源中偏移对应的行号与列号
+  SourceLocation locate(size_t offset) const;
+
   // 获取剩余未处理的输入
-  std::string get_remaining() const { return input.substr(position); }
+  std::string get_remaining() const {
+    return std::string(source.view().substr(position));
+  }
+};
+
+// 按固定大小分块读取 istream 或文件描述符，只保留尚未消费的输入
+class ChunkReader {
+private:
+  std::istream *stream = nullptr;
+  int fd = -1;
+  size_t chunk_size;
+  std::string window; // 输入中 [base, base + window.size()) 的部分
+  size_t base = 0;
+  size_t keep = 0; // keep - 1 之前的输入可以丢弃（保留一个字节用于判断行首）
+  bool eof = false;
+
+  // 丢弃不再需要的输入并读取下一块
+  void refill();
+
+public:
+  ChunkReader(std::istream &stream, size_t chunk_size)
+      : stream(&stream), chunk_size(chunk_size) {}
+  ChunkReader(int fd, size_t chunk_size) : fd(fd), chunk_size(chunk_size) {}
+
+  bool available(size_t pos) {
+    while (pos >= base + window.size() && !eof) {
+      refill();
+    }
+    return pos < base + window.size();
+  }
+  char at(size_t pos) const { return window[pos - base]; }
+
+  size_t find_newline(size_t pos, bool commit);
+
+  // 跳过空格与换行符，已跳过的部分不再需要
+  size_t skip_blanks(size_t pos);
+
+  void commit(size_t pos) { keep = pos; }
+
+  // 窗口内的一段输入，只对最近一个token有效
+  std::string_view slice(size_t offset, size_t length) const {
+    return std::string_view(window).substr(offset - base, length);
+  }
+
+  // 当前缓冲的字节数
+  size_t buffered() const { return window.size(); }
+};
+
+// 流式分析器：按需读取输入并逐个产生token，内存占用与输入大小无关
+struct StreamTokenizer {
+private:
+  Lexer lexer;
+  ChunkReader reader;
+  size_t position = 0;
+  bool in_char_mode = false;
+  bool error_tolerant = false;
+  std::vector<LexDiagnostic> diagnostics;
+
+public:
+  static constexpr size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+  StreamTokenizer(Lexer lexer, std::istream &stream,
+                  size_t chunk_size = DEFAULT_CHUNK_SIZE)
+      : lexer(std::move(lexer)), reader(stream, chunk_size) {}
+
+  StreamTokenizer(Lexer lexer, int fd, size_t chunk_size = DEFAULT_CHUNK_SIZE)
+      : lexer(std::move(lexer)), reader(fd, chunk_size) {}
+
+  StreamTokenizer(const std::vector<grammar::Terminal> &terminals,
+                  std::istream &stream,
+                  size_t chunk_size = DEFAULT_CHUNK_SIZE)
+      : StreamTokenizer(Lexer(terminals), stream, chunk_size) {}
+
+  StreamTokenizer(const std::vector<grammar::Terminal> &terminals, int fd,
+                  size_t chunk_size = DEFAULT_CHUNK_SIZE)
+      : StreamTokenizer(Lexer(terminals), fd, chunk_size) {}
+
+  // 获取下一个token的切片，切片文本只在下一次调用前有效
+  std::optional<TokenView> next_view() {
+    if (error_tolerant) {
+      return lexer.scan_tolerant(reader, position, in_char_mode, diagnostics);
+    }
+    return lexer.scan(reader, position, in_char_mode);
+  }
+
+  // 容错模式：遇到无法识别的字符时记录诊断信息并产生错误token，而不是抛出异常
+  void set_error_tolerant(bool tolerant) { error_tolerant = tolerant; }
+
+  // UTF-8 模式，见 Lexer::utf8
+  void set_utf8(bool enabled) { lexer.utf8 = enabled; }
+
+  // 容错模式下记录的全部词法错误
+  const std::vector<LexDiagnostic> &get_diagnostics() const {
+    return diagnostics;
+  }
+
+  // 获取下一个token
+  std::optional<Token> next_token();
+
+  // 最近一个token在输入中的原始文本
+  std::string_view text(const TokenView &view) const {
+    return reader.slice(view.offset, view.length);
+  }
+
+  // 获取当前位置（输入中的偏移）
+  size_t get_position() const { return position; }
 };
 
 } // namespace tokenizer
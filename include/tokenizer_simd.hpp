@@ -0,0 +1,71 @@
+#ifndef TOKENIZER_SIMD_HPP
+#define TOKENIZER_SIMD_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// 词法分析的热点扫描内核：按16/32字节分块比较，运行时根据CPU选择实现
+namespace tokenizer::simd {
+
+enum class Level { SCALAR, SSE42, AVX2 };
+
+// 当前CPU支持的最高级别
+Level detected_level();
+
+// 当前使用的级别
+Level active_level();
+
+// 强制使用不高于 level 的实现，用于对比测试
+void set_level(Level level);
+
+// 查找第一个不是空格或换行符的字节，找不到时返回 size
+size_t find_non_blank(const char *data, size_t size);
+
+// 查找第一个等于 byte 的字节，找不到时返回 size
+size_t find_byte(const char *data, size_t size, char byte);
+
+// 校验 UTF-8 编码，返回第一个非法序列的起始位置，全部合法时返回 size
+// 按块查表校验，纯 ASCII 块只检查最高位，发现错误后才逐个解码定位
+size_t validate_utf8(const char *data, size_t size);
+
+// 以 data[0] 开头的合法 UTF-8 序列的字节数，非法或被截断时返回 0
+// 拒绝过长编码、代理项与超出 U+10FFFF 的码点
+inline size_t utf8_sequence_length(const unsigned char *data, size_t size) {
+  if (size == 0) {
+    return 0;
+  }
+  unsigned char lead = data[0];
+  if (lead < 0x80) {
+    return 1;
+  }
+  size_t length;
+  // 第二个字节的合法范围，其余后续字节均为 0x80..0xBF
+  unsigned char low = 0x80;
+  unsigned char high = 0xBF;
+  if (lead >= 0xC2 && lead <= 0xDF) {
+    length = 2;
+  } else if (lead >= 0xE0 && lead <= 0xEF) {
+    length = 3;
+    low = lead == 0xE0 ? 0xA0 : 0x80;
+    high = lead == 0xED ? 0x9F : 0xBF;
+  } else if (lead >= 0xF0 && lead <= 0xF4) {
+    length = 4;
+    low = lead == 0xF0 ? 0x90 : 0x80;
+    high = lead == 0xF4 ? 0x8F : 0xBF;
+  } else {
+    return 0;
+  }
+  if (size < length || data[1] < low || data[1] > high) {
+    return 0;
+  }
+  for (size_t i = 2; i < length; i++) {
+    if ((data[i] & 0xC0) != 0x80) {
+      return 0;
+    }
+  }
+  return length;
+}
+
+} // namespace tokenizer::simd
+
+#endif // TOKENIZER_SIMD_HPP
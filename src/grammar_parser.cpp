@@ -1,49 +1,86 @@
 #include "../include/grammar_parser.hpp"
 #include <algorithm>
-#include <fstream>
 #include <iostream>
-#include <sstream>
 
 namespace grammar {
 
 std::optional<std::vector<GrammarRule>>
-parse_grammar(const std::string &grammar_str) {
+parse_grammar(std::string_view grammar_str) {
   std::vector<GrammarRule> grammar;
-  std::istringstream iss(grammar_str);
-  std::string line;
-  std::stringstream buffer;
-  while (std::getline(iss, line)) {
+  // 正在累积的规则：在原文中连续时只记录区间 [rule_start, rule_end)，
+  // 跳过了注释行或遇到续行后改为拼接到 joined
+  bool pending = false;
+  bool contiguous = true;
+  size_t rule_start = 0;
+  size_t rule_end = 0;
+  std::string joined;
+  bool in_action = false; // 是否处于未闭合的语义动作块中
+
+  // 把当前规则从原文切片转为拼接的字符串
+  auto materialize = [&]() {
+    if (pending && contiguous) {
+      joined.assign(grammar_str.substr(rule_start, rule_end - rule_start));
+      contiguous = false;
+    }
+  };
+
+  size_t pos = 0;
+  while (pos < grammar_str.size()) {
+    size_t newline = grammar_str.find('\n', pos);
+    bool has_newline = newline != std::string_view::npos;
+    size_t line_end = has_newline ? newline : grammar_str.size();
+    size_t line_start = pos;
+    std::string_view line = grammar_str.substr(pos, line_end - pos);
+    pos = has_newline ? newline + 1 : grammar_str.size();
+
     // 忽略注释行和空行
     if (line.empty() || line[0] == '#') {
+      materialize();
       continue;
     }
-    // 处理续行
-    if (!line.empty() && line.back() == '\\') {
-      buffer << line.substr(0, line.length() - 1);
-      continue;
+
+    // 续行：去掉行尾的反斜杠，与下一行直接相连
+    bool continued = line.back() == '\\';
+    if (continued) {
+      line.remove_suffix(1);
+    }
+    if (!pending) {
+      pending = true;
+      contiguous = !continued;
+      rule_start = line_start;
+      joined.clear();
+    } else if (continued) {
+      materialize();
+    }
+    if (contiguous) {
+      rule_end = line_start + line.size();
+    } else {
+      joined.append(line);
     }
-    buffer << line;
 
-    // 检查是否包含语义动作块
-    size_t backtick_pos = buffer.str().find('`');
-    while (backtick_pos != std::string::npos) {
-      size_t next_backtick = buffer.str().find('`', backtick_pos + 1);
-      if (next_backtick == std::string::npos) {
-        // 等待下一个输入行以完成语义动作块
-        break;
-      }
-      backtick_pos = buffer.str().find('`', next_backtick + 1);
+    // 只统计新加入这一行的反引号，判断语义动作块是否闭合
+    if (std::count(line.begin(), line.end(), '`') % 2 == 1) {
+      in_action = !in_action;
+    }
+    if (continued) {
+      continue;
     }
 
     // 如果语义动作块未闭合，继续读取下一行
-    if (backtick_pos != std::string::npos) {
-      buffer << '\n';
+    if (in_action) {
+      if (contiguous && has_newline) {
+        rule_end = line_end + 1;
+      } else {
+        materialize();
+        joined += '\n';
+      }
       continue;
     }
 
-    auto rule_str = buffer.str();
-    buffer.str("");
-    buffer.clear();
+    std::string_view rule_str =
+        contiguous ? grammar_str.substr(rule_start, rule_end - rule_start)
+                   : std::string_view(joined);
+    pending = false;
     auto rule = GrammarRule::parse(rule_str);
     if (!rule) {
       std::cerr << "Error: Invalid grammar rule: " << rule_str << std::endl;
@@ -51,20 +88,29 @@ parse_grammar(const std::string &grammar_str) {
     }
     grammar.push_back(rule.value());
   }
+  if (pending) {
+    std::cerr << "Error: Unterminated semantic action at end of grammar"
+              << std::endl;
+  }
   return grammar;
 }
 
 std::optional<std::vector<GrammarRule>>
 parse_grammar_from_file(const std::string &filename) {
-  std::ifstream file(filename);
-  if (!file.is_open()) {
-    std::cerr << "Error: Failed to open file " << filename << std::endl;
+  auto file = GrammarFile::map(filename);
+  if (!file) {
     return std::nullopt;
   }
-  std::stringstream buffer;
-  buffer << file.rdbuf();
-  file.close();
-  return parse_grammar(buffer.str());
+  return parse_grammar(file->view());
+}
+
+uint64_t hash_grammar_text(std::string_view text) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (char c : text) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
 }
 
 void print_grammar(const std::vector<GrammarRule> &grammar) {
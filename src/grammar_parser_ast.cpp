@@ -5,7 +5,7 @@
 
 namespace grammar {
 
-std::optional<ASTRule> ASTRule::parse(const std::string &str) {
+std::optional<ASTRule> ASTRule::parse(std::string_view str) {
   if (str.empty()) {
     std::cerr << "Error: AST rule cannot be an empty string" << std::endl;
     return std::nullopt;
@@ -16,17 +16,17 @@ std::optional<ASTRule> ASTRule::parse(const std::string &str) {
   std::vector<size_t> children;
 
   size_t semicolon_pos = str.find(';');
-  if (semicolon_pos == std::string::npos) {
+  if (semicolon_pos == std::string_view::npos) {
     std::cerr << "Error: Missing ';' in AST rule: " << str << std::endl;
     return std::nullopt;
   }
 
   // 判断是否扁平化
-  std::string prefix = str.substr(0, semicolon_pos);
-  do_flatten = (prefix.find('*') != std::string::npos);
+  std::string_view prefix = str.substr(0, semicolon_pos);
+  do_flatten = (prefix.find('*') != std::string_view::npos);
 
   // 获取分号后的部分
-  std::string content = str.substr(semicolon_pos + 1);
+  std::string_view content = str.substr(semicolon_pos + 1);
   std::string trimmed;
   std::remove_copy_if(content.begin(), content.end(),
                       std::back_inserter(trimmed), ::isspace);
@@ -0,0 +1,67 @@
+#include "../include/grammar_parser.hpp"
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace grammar {
+
+GrammarFile::GrammarFile(GrammarFile &&other) noexcept
+    : data(other.data), size(other.size) {
+  other.data = nullptr;
+  other.size = 0;
+}
+
+GrammarFile &GrammarFile::operator=(GrammarFile &&other) noexcept {
+  if (this != &other) {
+    release();
+    data = other.data;
+    size = other.size;
+    other.data = nullptr;
+    other.size = 0;
+  }
+  return *this;
+}
+
+void GrammarFile::release() {
+  if (data != nullptr) {
+    munmap(const_cast<char *>(data), size);
+    data = nullptr;
+    size = 0;
+  }
+}
+
+std::optional<GrammarFile> GrammarFile::map(const std::string &filename) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "Error: Failed to open file " << filename << std::endl;
+    return std::nullopt;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    std::cerr << "Error: Failed to stat file " << filename << std::endl;
+    close(fd);
+    return std::nullopt;
+  }
+
+  GrammarFile file;
+  // 空文件无法映射，直接作为空语法
+  if (st.st_size > 0) {
+    void *addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ,
+                      MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+      std::cerr << "Error: Failed to map file " << filename << std::endl;
+      close(fd);
+      return std::nullopt;
+    }
+    madvise(addr, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+    file.data = static_cast<const char *>(addr);
+    file.size = static_cast<size_t>(st.st_size);
+  }
+  close(fd);
+  return file;
+}
+
+} // namespace grammar
@@ -1,4 +1,5 @@
 #include "../include/grammar_parser.hpp"
+#include <algorithm>
 #include <unordered_set>
 
 namespace grammar {
@@ -42,7 +43,16 @@ std::vector<Terminal> Grammar::extract_terminals() const {
       }
     }
   }
-  return std::vector<grammar::Terminal>(terminals.begin(), terminals.end());
+  // 按值排序，使终结符编号（即下标）与符号表的编号无关，保持稳定
+  std::vector<grammar::Terminal> result(terminals.begin(), terminals.end());
+  std::sort(result.begin(), result.end(),
+            [](const grammar::Terminal &a, const grammar::Terminal &b) {
+              if (a.id != b.id) {
+                return a.value() < b.value();
+              }
+              return a.is_token < b.is_token;
+            });
+  return result;
 }
 
 } // namespace grammar
\ No newline at end of file
@@ -0,0 +1,403 @@
+#include "../include/grammar_parser.hpp"
+#include <algorithm>
+#include <unordered_set>
+
+namespace grammar {
+
+namespace {
+
+using Production = std::vector<Symbol>;
+
+bool is_blank(const std::string &str) {
+  return std::all_of(str.begin(), str.end(),
+                     [](char c) { return std::isspace(c); });
+}
+
+// 规则是否只承担词法作用：展平、保留全部子树且没有语义动作
+bool is_lexical_rule(const GrammarRule &rule) {
+  return rule.ast_rule.do_flatten && rule.ast_rule.use_all_children &&
+         is_blank(rule.sematic_actions);
+}
+
+// 正则子文法的分析与自动机构造
+class RegularAnalysis {
+private:
+  const std::unordered_map<SymbolId, std::vector<GrammarRule>> &rule_map;
+  const std::unordered_set<SymbolId> &lexical;
+
+  // 强连通分量（Tarjan）
+  std::unordered_map<SymbolId, int> scc_of;
+  std::vector<std::vector<SymbolId>> sccs;
+  std::unordered_map<SymbolId, int> index, low;
+  std::vector<SymbolId> stack;
+  std::unordered_set<SymbolId> on_stack;
+  int next_index = 0;
+
+  // 分量的递归方向
+  enum class Linearity { NONE, LEFT, RIGHT, IRREGULAR };
+  std::vector<Linearity> linearity;
+  std::unordered_map<SymbolId, bool> regular_memo;
+
+  struct Fragment {
+    int start;
+    int accept;
+  };
+
+  std::vector<const Production *> productions_of(SymbolId name) {
+    std::vector<const Production *> result;
+    for (const auto &rule : rule_map.at(name)) {
+      for (const auto &prod : rule.right.production) {
+        result.push_back(&prod);
+      }
+    }
+    return result;
+  }
+
+  void strong_connect(SymbolId name) {
+    index[name] = low[name] = next_index++;
+    stack.push_back(name);
+    on_stack.insert(name);
+
+    for (const auto *prod : productions_of(name)) {
+      for (const auto &sym : *prod) {
+        if (!std::holds_alternative<NonTerminal>(sym)) {
+          continue;
+        }
+        SymbolId next = std::get<NonTerminal>(sym).id;
+        if (index.find(next) == index.end()) {
+          strong_connect(next);
+          low[name] = std::min(low[name], low[next]);
+        } else if (on_stack.count(next)) {
+          low[name] = std::min(low[name], index[next]);
+        }
+      }
+    }
+
+    if (low[name] == index[name]) {
+      std::vector<SymbolId> component;
+      SymbolId member;
+      do {
+        member = stack.back();
+        stack.pop_back();
+        on_stack.erase(member);
+        scc_of[member] = static_cast<int>(sccs.size());
+        component.push_back(member);
+      } while (member != name);
+      sccs.push_back(component);
+    }
+  }
+
+  // 分量内的递归必须全部是左线性或全部是右线性
+  Linearity compute_linearity(int scc) {
+    bool recursive = sccs[scc].size() > 1;
+    bool left = false;
+    bool right = false;
+    for (const auto &name : sccs[scc]) {
+      for (const auto *prod : productions_of(name)) {
+        std::vector<size_t> inner;
+        for (size_t i = 0; i < prod->size(); i++) {
+          const auto &sym = (*prod)[i];
+          if (std::holds_alternative<NonTerminal>(sym) &&
+              scc_of[std::get<NonTerminal>(sym).id] == scc) {
+            inner.push_back(i);
+          }
+        }
+        if (inner.empty()) {
+          continue;
+        }
+        recursive = true;
+        if (inner.size() > 1) {
+          return Linearity::IRREGULAR;
+        }
+        if (prod->size() == 1) {
+          continue; // 单位产生式既是左线性也是右线性
+        }
+        if (inner[0] == 0) {
+          left = true;
+        } else if (inner[0] == prod->size() - 1) {
+          right = true;
+        } else {
+          return Linearity::IRREGULAR;
+        }
+      }
+    }
+    if (left && right) {
+      return Linearity::IRREGULAR;
+    }
+    if (!recursive) {
+      return Linearity::NONE;
+    }
+    return right ? Linearity::RIGHT : Linearity::LEFT;
+  }
+
+  // 从 from 出发依次识别 symbols，最后空转移到 to
+  void connect(ByteNfa &nfa, int from, const Production &symbols, size_t begin,
+               size_t end, int to) {
+    int cur = from;
+    for (size_t i = begin; i < end; i++) {
+      const auto &sym = symbols[i];
+      if (std::holds_alternative<Terminal>(sym)) {
+        for (char c : std::get<Terminal>(sym).value()) {
+          int next = nfa.add_state();
+          nfa.states[cur].edges.emplace_back(static_cast<unsigned char>(c),
+                                             next);
+          cur = next;
+        }
+      } else {
+        Fragment inner = build(nfa, std::get<NonTerminal>(sym).id);
+        nfa.states[cur].epsilon.push_back(inner.start);
+        cur = inner.accept;
+      }
+    }
+    nfa.states[cur].epsilon.push_back(to);
+  }
+
+public:
+  RegularAnalysis(
+      const std::unordered_map<SymbolId, std::vector<GrammarRule>> &rule_map,
+      const std::unordered_set<SymbolId> &lexical)
+      : rule_map(rule_map), lexical(lexical) {
+    for (const auto &name : lexical) {
+      if (index.find(name) == index.end()) {
+        strong_connect(name);
+      }
+    }
+    for (size_t i = 0; i < sccs.size(); i++) {
+      linearity.push_back(compute_linearity(static_cast<int>(i)));
+    }
+  }
+
+  int scc(SymbolId name) const { return scc_of.at(name); }
+
+  bool is_singleton(SymbolId name) const {
+    return sccs[scc_of.at(name)].size() == 1;
+  }
+
+  bool is_recursive(SymbolId name) const {
+    return linearity[scc_of.at(name)] != Linearity::NONE;
+  }
+
+  // 非终结符的语言是否为正则：自身分量线性且依赖的分量均为正则
+  bool is_regular(SymbolId name) {
+    auto it = regular_memo.find(name);
+    if (it != regular_memo.end()) {
+      return it->second;
+    }
+    int own = scc_of.at(name);
+    regular_memo[name] = linearity[own] != Linearity::IRREGULAR;
+    bool result = regular_memo[name];
+    for (const auto *prod : productions_of(name)) {
+      for (const auto &sym : *prod) {
+        if (!result) {
+          break;
+        }
+        if (std::holds_alternative<NonTerminal>(sym)) {
+          SymbolId next = std::get<NonTerminal>(sym).id;
+          if (scc_of.at(next) != own) {
+            result = is_regular(next);
+          }
+        }
+      }
+    }
+    regular_memo[name] = result;
+    return result;
+  }
+
+  // 在 nfa 中构造识别 name 语言的片段，下层非终结符按引用内联展开
+  Fragment build(ByteNfa &nfa, SymbolId name) {
+    int own = scc_of.at(name);
+    const auto &members = sccs[own];
+    auto inner_index = [&](const Production &prod, size_t i) {
+      const auto &sym = prod[i];
+      return std::holds_alternative<NonTerminal>(sym) &&
+             scc_of.at(std::get<NonTerminal>(sym).id) == own;
+    };
+
+    switch (linearity[own]) {
+    case Linearity::LEFT: {
+      // 左线性：e[B] 表示已读入 B 的一个句子
+      int start = nfa.add_state();
+      std::unordered_map<SymbolId, int> ends;
+      for (const auto &member : members) {
+        ends[member] = nfa.add_state();
+      }
+      for (const auto &member : members) {
+        for (const auto *prod : productions_of(member)) {
+          if (!prod->empty() && inner_index(*prod, 0)) {
+            SymbolId first = std::get<NonTerminal>((*prod)[0]).id;
+            connect(nfa, ends[first], *prod, 1, prod->size(), ends[member]);
+          } else {
+            connect(nfa, start, *prod, 0, prod->size(), ends[member]);
+          }
+        }
+      }
+      return Fragment{start, ends[name]};
+    }
+    case Linearity::RIGHT: {
+      // 右线性：b[B] 表示接下来要读入 B 的一个句子
+      int accept = nfa.add_state();
+      std::unordered_map<SymbolId, int> begins;
+      for (const auto &member : members) {
+        begins[member] = nfa.add_state();
+      }
+      for (const auto &member : members) {
+        for (const auto *prod : productions_of(member)) {
+          if (!prod->empty() && inner_index(*prod, prod->size() - 1)) {
+            SymbolId last = std::get<NonTerminal>(prod->back()).id;
+            connect(nfa, begins[member], *prod, 0, prod->size() - 1,
+                    begins[last]);
+          } else {
+            connect(nfa, begins[member], *prod, 0, prod->size(), accept);
+          }
+        }
+      }
+      return Fragment{begins[name], accept};
+    }
+    default: {
+      int start = nfa.add_state();
+      int accept = nfa.add_state();
+      for (const auto *prod : productions_of(name)) {
+        connect(nfa, start, *prod, 0, prod->size(), accept);
+      }
+      return Fragment{start, accept};
+    }
+    }
+  }
+};
+
+} // namespace
+
+LexicalPromotion Grammar::promote_regular_nonterminals() {
+  // 词法辅助非终结符：所有规则都只承担词法作用，
+  // 且只引用终结符或其它词法辅助非终结符
+  std::unordered_set<SymbolId> lexical;
+  for (const auto &[name, rules] : rule_map) {
+    if (std::all_of(rules.begin(), rules.end(), is_lexical_rule)) {
+      lexical.insert(name);
+    }
+  }
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (auto it = lexical.begin(); it != lexical.end();) {
+      bool closed = true;
+      for (const auto &rule : rule_map.at(*it)) {
+        for (const auto &prod : rule.right.production) {
+          for (const auto &sym : prod) {
+            if (std::holds_alternative<NonTerminal>(sym) &&
+                !lexical.count(std::get<NonTerminal>(sym).id)) {
+              closed = false;
+            }
+          }
+        }
+      }
+      if (closed) {
+        ++it;
+      } else {
+        it = lexical.erase(it);
+        changed = true;
+      }
+    }
+  }
+
+  RegularAnalysis analysis(rule_map, lexical);
+
+  // 被提升的非终结符在分量外的每处引用都必须是非展平规则中唯一的符号，
+  // 这样语法树中该位置只是把一个子树换成一个叶子
+  std::unordered_map<SymbolId, bool> replaceable;
+  std::unordered_set<SymbolId> referenced;
+  for (const auto &name : lexical) {
+    replaceable[name] = true;
+  }
+  for (const auto &[name, rules] : rule_map) {
+    for (const auto &rule : rules) {
+      for (const auto &prod : rule.right.production) {
+        for (const auto &sym : prod) {
+          if (!std::holds_alternative<NonTerminal>(sym)) {
+            continue;
+          }
+          SymbolId ref = std::get<NonTerminal>(sym).id;
+          if (!lexical.count(ref)) {
+            continue;
+          }
+          if (lexical.count(name) && analysis.scc(name) == analysis.scc(ref)) {
+            continue;
+          }
+          bool sole = !lexical.count(name) && prod.size() == 1 &&
+                      !rule.ast_rule.do_flatten;
+          if (sole) {
+            referenced.insert(ref);
+          } else {
+            replaceable[ref] = false;
+          }
+        }
+      }
+    }
+  }
+
+  // 只提升语言无限的正则非终结符，有限的辅助规则（如单个字母）保持原样
+  std::vector<SymbolId> promoted;
+  for (const auto &name : lexical) {
+    if (replaceable[name] && referenced.count(name) &&
+        analysis.is_singleton(name) && analysis.is_recursive(name) &&
+        analysis.is_regular(name)) {
+      promoted.push_back(name);
+    }
+  }
+  std::sort(promoted.begin(), promoted.end(), [](SymbolId a, SymbolId b) {
+    return symbol_name(a) < symbol_name(b);
+  });
+
+  LexicalPromotion result;
+  for (const auto &name : promoted) {
+    LexicalToken token{symbol_name(name), ByteNfa{}};
+    auto fragment = analysis.build(token.nfa, name);
+    token.nfa.start = fragment.start;
+    token.nfa.accept = fragment.accept;
+    result.tokens.push_back(std::move(token));
+  }
+
+  // 结构性终结符：出现在非词法辅助规则中的终结符
+  std::unordered_set<Terminal> structural;
+  std::unordered_set<Terminal> helpers;
+  for (const auto &[name, rules] : rule_map) {
+    auto &target = lexical.count(name) ? helpers : structural;
+    for (const auto &rule : rules) {
+      for (const auto &prod : rule.right.production) {
+        for (const auto &sym : prod) {
+          if (std::holds_alternative<Terminal>(sym)) {
+            target.insert(std::get<Terminal>(sym));
+          }
+        }
+      }
+    }
+  }
+  for (const auto &terminal : helpers) {
+    if (!structural.count(terminal)) {
+      result.helper_terminals.push_back(terminal);
+    }
+  }
+
+  // 引用处替换为记号终结符，并移除被提升的规则
+  for (const auto &name : promoted) {
+    rule_map.erase(name);
+  }
+  std::unordered_set<SymbolId> promoted_set(promoted.begin(), promoted.end());
+  std::erase_if(order, [&](SymbolId name) { return promoted_set.count(name); });
+  for (auto &[name, rules] : rule_map) {
+    for (auto &rule : rules) {
+      for (auto &prod : rule.right.production) {
+        for (auto &sym : prod) {
+          if (std::holds_alternative<NonTerminal>(sym) &&
+              promoted_set.count(std::get<NonTerminal>(sym).id)) {
+            sym = Terminal(std::get<NonTerminal>(sym).name(), true);
+          }
+        }
+      }
+    }
+  }
+
+  return result;
+}
+
+} // namespace grammar
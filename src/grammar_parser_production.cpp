@@ -7,7 +7,7 @@ namespace grammar {
 
 // 只识别被单引号、双引号或尖括号包裹的
 // token，忽略其它空白（除换行外）以及无效字符
-std::optional<ProductionList> ProductionList::parse(const std::string &str) {
+std::optional<ProductionList> ProductionList::parse(std::string_view str) {
   if (str.empty()) {
     std::cerr << "Error: Production list cannot be an empty string"
               << std::endl;
@@ -39,7 +39,6 @@ std::optional<ProductionList> ProductionList::parse(const std::string &str) {
     else if (ch == '\'') {
       size_t start = i;
       i++; // 跳过起始单引号
-      size_t tokenStart = i;
       while (i < str.size() && str[i] != '\'') {
         i++;
       }
@@ -49,9 +48,9 @@ std::optional<ProductionList> ProductionList::parse(const std::string &str) {
                   << str.substr(start) << std::endl;
         return std::nullopt;
       }
-      std::string token = str.substr(tokenStart, i - tokenStart);
+      std::string_view token = str.substr(start, i - start + 1);
       i++; // 跳过结束单引号
-      auto maybeTerm = Terminal::parse("'" + token + "'");
+      auto maybeTerm = Terminal::parse(token);
       if (!maybeTerm) {
         return std::nullopt;
       }
@@ -61,7 +60,6 @@ std::optional<ProductionList> ProductionList::parse(const std::string &str) {
     else if (ch == '"') {
       size_t start = i;
       i++; // 跳过起始双引号
-      size_t tokenStart = i;
       while (i < str.size() && str[i] != '"') {
         i++;
       }
@@ -71,9 +69,9 @@ std::optional<ProductionList> ProductionList::parse(const std::string &str) {
                   << str.substr(start) << std::endl;
         return std::nullopt;
       }
-      std::string token = str.substr(tokenStart, i - tokenStart);
+      std::string_view token = str.substr(start, i - start + 1);
       i++; // 跳过结束双引号
-      auto maybeNonTerm = NonTerminal::parse("\"" + token + "\"");
+      auto maybeNonTerm = NonTerminal::parse(token);
       if (!maybeNonTerm) {
         return std::nullopt;
       }
@@ -83,7 +81,6 @@ std::optional<ProductionList> ProductionList::parse(const std::string &str) {
     else if (ch == '<') {
       size_t start = i;
       i++; // 跳过起始尖括号
-      size_t tokenStart = i;
       while (i < str.size() && str[i] != '>') {
         i++;
       }
@@ -93,9 +90,9 @@ std::optional<ProductionList> ProductionList::parse(const std::string &str) {
                   << str.substr(start) << std::endl;
         return std::nullopt;
       }
-      std::string token = str.substr(tokenStart, i - tokenStart);
+      std::string_view token = str.substr(start, i - start + 1);
       i++; // 跳过结束尖括号
-      auto maybeSpecial = Terminal::parse("<" + token + ">");
+      auto maybeSpecial = Terminal::parse(token);
       if (!maybeSpecial) {
         return std::nullopt;
       }
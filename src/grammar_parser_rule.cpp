@@ -1,10 +1,18 @@
 #include "../include/grammar_parser.hpp"
 #include <algorithm>
+#include <cctype>
 #include <iostream>
 
 namespace grammar {
 
-std::optional<GrammarRule> GrammarRule::parse(const std::string &str) {
+// 是否只包含空白字符
+static bool is_blank(std::string_view str) {
+  return std::all_of(str.begin(), str.end(), [](char c) {
+    return std::isspace(static_cast<unsigned char>(c));
+  });
+}
+
+std::optional<GrammarRule> GrammarRule::parse(std::string_view str) {
   if (str.empty()) {
     std::cerr << "Error: Grammar rule cannot be an empty string" << std::endl;
     return std::nullopt;
@@ -12,14 +20,15 @@ std::optional<GrammarRule> GrammarRule::parse(const std::string &str) {
   // 找到第一个被 [] 包裹的部分，代表 AST 规则
   size_t ast_start = str.find('[');
   size_t ast_end = str.find(']');
-  if (ast_start == std::string::npos || ast_end == std::string::npos ||
-      ast_start >= ast_end) {
+  if (ast_start == std::string_view::npos ||
+      ast_end == std::string_view::npos || ast_start >= ast_end) {
     std::cerr << "Error: Grammar rule must contain AST rule enclosed in square "
                  "brackets. Invalid rule: "
               << str << std::endl;
     return std::nullopt;
   }
-  std::string ast_str = str.substr(ast_start + 1, ast_end - ast_start - 1);
+  std::string_view ast_str =
+      str.substr(ast_start + 1, ast_end - ast_start - 1);
   auto ast_rule = ASTRule::parse(ast_str);
   if (!ast_rule) {
     std::cerr << "Error: Invalid AST rule in grammar rule: " << ast_str
@@ -28,31 +37,45 @@ std::optional<GrammarRule> GrammarRule::parse(const std::string &str) {
   }
 
   size_t arrow_pos = str.find("->");
-  if (arrow_pos == std::string::npos) {
+  if (arrow_pos == std::string_view::npos) {
     std::cerr << "Error: Grammar rule must contain '->'. Invalid rule: " << str
               << std::endl;
     return std::nullopt;
   }
-  std::string lhs = str.substr(0, arrow_pos).substr(ast_end + 1, -1);
-  std::string rhs = str.substr(arrow_pos + 2);
+  std::string_view lhs = str.substr(0, arrow_pos).substr(ast_end + 1);
+  std::string_view rhs = str.substr(arrow_pos + 2);
 
-  // 解析左侧的变量（非终结符），忽略左右两边多余的空白（包括换行）
-  lhs.erase(std::remove_if(lhs.begin(), lhs.end(), ::isspace), lhs.end());
-  auto non_term = NonTerminal::parse(lhs);
+  // 解析左侧的变量（非终结符），忽略其中的空白（包括换行）
+  std::string lhs_name;
+  lhs_name.reserve(lhs.size());
+  std::remove_copy_if(lhs.begin(), lhs.end(), std::back_inserter(lhs_name),
+                      [](char c) {
+                        return std::isspace(static_cast<unsigned char>(c));
+                      });
+  auto non_term = NonTerminal::parse(lhs_name);
   if (!non_term) {
     return std::nullopt;
   }
 
-  // 查看右侧有没有 `` 包裹的部分，如果有就是语义动作，要从 rhs 提取并删除
+  // 查看右侧有没有 `` 包裹的部分，如果有就是语义动作，要从 rhs 中去掉
   size_t sem_start = rhs.find('`');
   size_t sem_end = rhs.find('`', sem_start + 1);
-  std::string sem_str;
+  std::string_view sem_str;
+  std::string productions; // 语义动作之后还有产生式时才需要拼接
 
-  if (sem_start != std::string::npos && sem_end != std::string::npos &&
-      sem_end > sem_start) {
+  if (sem_start != std::string_view::npos &&
+      sem_end != std::string_view::npos && sem_end > sem_start) {
     sem_str = rhs.substr(sem_start + 1,
                          sem_end - sem_start - 1); // 取出不含 ` 的语义动作代码
-    rhs.erase(sem_start, sem_end - sem_start + 1); // 删除整个 `...`
+    std::string_view head = rhs.substr(0, sem_start);
+    std::string_view tail = rhs.substr(sem_end + 1);
+    if (is_blank(tail)) {
+      // 尾部的空白不影响产生式，只有产生式为空时才保留它
+      rhs = head.empty() ? tail : head;
+    } else {
+      productions.append(head).append(tail);
+      rhs = productions;
+    }
   }
 
   // 右侧的产生式列表直接传给 ProductionList::parse 进行解析
@@ -62,7 +85,7 @@ std::optional<GrammarRule> GrammarRule::parse(const std::string &str) {
   }
 
   return GrammarRule{non_term.value(), prod_list.value(), ast_rule.value(),
-                     sem_str};
+                     std::string(sem_str)};
 }
 
 std::string GrammarRule::to_string() const {
@@ -1,10 +1,69 @@
 #include "../include/grammar_parser.hpp"
 #include <iostream>
+#include <mutex>
+#include <stdexcept>
 
 namespace grammar {
 
+SymbolTable &SymbolTable::global() {
+  static SymbolTable table;
+  return table;
+}
+
+SymbolId SymbolTable::intern(std::string_view name) {
+  if (auto id = find(name)) {
+    return *id;
+  }
+  std::unique_lock lock(mutex);
+  if (frozen.load(std::memory_order_relaxed)) {
+    throw std::logic_error("Error: Symbol table is frozen, cannot intern " +
+                           std::string(name));
+  }
+  auto it = ids.find(name);
+  if (it != ids.end()) {
+    return it->second;
+  }
+  auto id = static_cast<SymbolId>(names.size());
+  names.emplace_back(name);
+  ids.emplace(names.back(), id);
+  return id;
+}
+
+std::optional<SymbolId> SymbolTable::find(std::string_view name) const {
+  std::shared_lock lock(mutex, std::defer_lock);
+  if (!frozen.load(std::memory_order_acquire)) {
+    lock.lock();
+  }
+  auto it = ids.find(name);
+  if (it == ids.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+const std::string &SymbolTable::name(SymbolId id) const {
+  std::shared_lock lock(mutex, std::defer_lock);
+  if (!frozen.load(std::memory_order_acquire)) {
+    lock.lock();
+  }
+  return names[id];
+}
+
+size_t SymbolTable::size() const {
+  std::shared_lock lock(mutex, std::defer_lock);
+  if (!frozen.load(std::memory_order_acquire)) {
+    lock.lock();
+  }
+  return names.size();
+}
+
+void SymbolTable::freeze() {
+  std::unique_lock lock(mutex);
+  frozen.store(true, std::memory_order_release);
+}
+
 // Terminal类的实现
-std::optional<Terminal> Terminal::parse(const std::string &str) {
+std::optional<Terminal> Terminal::parse(std::string_view str) {
   if (str.empty()) {
     std::cerr << "Error: Terminal cannot be an empty string" << std::endl;
     return std::nullopt;
@@ -20,7 +79,7 @@ std::optional<Terminal> Terminal::parse(const std::string &str) {
                              {"rangle", ">"}, {"hash", "#"},
                              {"semic", ";"},  {"bquot", "`"}};
 
-    std::string special = str.substr(1, str.size() - 2);
+    std::string special(str.substr(1, str.size() - 2));
     auto it = special_terminals.find(special);
     if (it != special_terminals.end()) {
       return Terminal{it->second};
@@ -36,11 +95,16 @@ std::optional<Terminal> Terminal::parse(const std::string &str) {
 }
 
 std::string Terminal::to_string() const {
-  return "\'" + (this->value != "\n" ? this->value : "\\n") + "\'";
+  // 词法记号直接显示原非终结符名
+  const std::string &value = this->value();
+  if (this->is_token) {
+    return value;
+  }
+  return "\'" + (value != "\n" ? value : "\\n") + "\'";
 }
 
 // NonTerminal类的实现
-std::optional<NonTerminal> NonTerminal::parse(const std::string &str) {
+std::optional<NonTerminal> NonTerminal::parse(std::string_view str) {
   if (str.empty()) {
     std::cerr << "Error: NonTerminal cannot be an empty string" << std::endl;
     return std::nullopt;
@@ -54,6 +118,8 @@ std::optional<NonTerminal> NonTerminal::parse(const std::string &str) {
   return std::nullopt;
 }
 
-std::string NonTerminal::to_string() const { return "\"" + this->name + "\""; }
+std::string NonTerminal::to_string() const {
+  return "\"" + this->name() + "\"";
+}
 
 } // namespace grammar
\ No newline at end of file
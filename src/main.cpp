@@ -1,108 +1,194 @@
 #include "../include/grammar_parser.hpp"
 #include "../include/slr_parser.hpp"
+#include "../include/slr_parser_cache.hpp"
 #include "../include/tokenizer.hpp"
 #include <fstream>
 #include <iostream>
-#include <sstream>
 #include <vector>
 
-int main() {
+int main(int argc, char *argv[]) {
+  // --check-grammar：只做文法静态分析，供持续集成检查，不构建分析表
+  // --lalr：按 LALR(1) 计算归约的向前看，默认为 SLR(1)
+  // --parallel：输入足够大时按硬件线程数并行词法分析
+  // --tolerant：容错模式，一次报告文件中的全部词法错误
+  // --utf8：按 UTF-8 处理输入，字符字面量中可以使用多字节字符
+  bool check_only = false;
+  bool parallel = false;
+  bool tolerant = false;
+  bool utf8 = false;
+  auto mode = slr::ParserMode::SLR1;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--check-grammar") {
+      check_only = true;
+    } else if (arg == "--lalr") {
+      mode = slr::ParserMode::LALR1;
+    } else if (arg == "--parallel") {
+      parallel = true;
+    } else if (arg == "--tolerant") {
+      tolerant = true;
+    } else if (arg == "--utf8") {
+      utf8 = true;
+    }
+  }
+
   // 解析语法文件
   const std::string grammar_file = "grammar.txt";
-  auto grammar_rules = grammar::parse_grammar_from_file(grammar_file);
-  if (!grammar_rules) {
-    std::cerr << "Failed to parse grammar file: " << grammar_file << std::endl;
+  auto grammar_text = grammar::GrammarFile::map(grammar_file);
+  if (!grammar_text) {
+    std::cerr << "Failed to read grammar file: " << grammar_file << std::endl;
     return 1;
   }
-  grammar::print_grammar(grammar_rules.value());
+  const std::string start_symbol = "program";
+
+  // 分析表缓存：语法文本、开始符号、构造方法与程序本身都没有改变时，
+  // 跳过文法解析、分析表构建与JSON导出，直接映射上次构建的结果
+  // 命中缓存时输出与首次运行不同：不打印文法与提升的词法记号，
+  // 不重新导出 slr_parser.json，并打印 "Loaded parser tables from ..."；
+  // token、语法树与 AST 的输出不变
+  // 两种构造方法各用一个缓存文件，交替使用时不会互相覆盖
+  const std::string cache_file = mode == slr::ParserMode::LALR1
+                                     ? "slr_parser.lalr.cache"
+                                     : "slr_parser.cache";
+  const uint64_t cache_key =
+      slr::ParserCache::key(grammar_text->view(), start_symbol, mode);
+  std::optional<slr::ParserCache> cache;
+  if (!check_only) {
+    cache = slr::ParserCache::open(cache_file, cache_key);
+  }
 
-  // 提取所有终结符
-  auto g = grammar::Grammar{grammar_rules.value()};
-  auto terminals = g.extract_terminals();
+  std::optional<grammar::Grammar> grammar;
+  std::optional<tokenizer::Lexer> lexer;
+  if (cache) {
+    std::cout << "Loaded parser tables from " << cache_file << std::endl;
+    lexer.emplace(cache->lexer());
+  } else {
+    auto grammar_rules = grammar::parse_grammar(grammar_text->view());
+    if (!grammar_rules) {
+      std::cerr << "Failed to parse grammar file: " << grammar_file
+                << std::endl;
+      return 1;
+    }
+    if (!check_only) {
+      grammar::print_grammar(grammar_rules.value());
+    }
 
-  // 读取test.mygo文件内容
+    // 将标识符、数字串等正则子文法提升为词法记号，再提取所有终结符
+    grammar.emplace(grammar_rules.value());
+    auto promotion = grammar->promote_regular_nonterminals();
+    if (check_only) {
+      auto flat = slr::CompiledGrammar::compile(
+          *grammar, grammar::intern_symbol(start_symbol),
+          grammar::intern_symbol("S'"));
+      auto analysis = slr::GrammarAnalysis::analyze(flat);
+      analysis.print_report(flat, std::cout);
+      return analysis.has_useless_symbols() ? 1 : 0;
+    }
+    for (const auto &token : promotion.tokens) {
+      std::cout << "Promoted lexical token: " << token.name << std::endl;
+    }
+    auto terminals = grammar->extract_terminals();
+
+    // 优先使用编译进程序的生成词法表，语法文件改动导致表失效时在运行时构建
+    lexer = tokenizer::Lexer::from_generated(
+        terminals, grammar::hash_grammar_text(grammar_text->view()));
+    if (!lexer) {
+      lexer.emplace(terminals, promotion);
+    }
+  }
+
+  // 将test.sgo映射到内存，词法分析直接在映射上进行
   const std::string input_file = "test.sgo";
-  std::ifstream file(input_file);
-  if (!file.is_open()) {
+  auto source = tokenizer::SourceBuffer::map_file(input_file);
+  if (!source) {
     std::cerr << "Failed to open input file: " << input_file << std::endl;
     return 1;
   }
 
-  std::stringstream buffer;
-  buffer << file.rdbuf();
-  std::string input = buffer.str();
-  file.close();
-
-  // 创建Tokenizer对象
-  tokenizer::Tokenizer tokenizer(terminals, input);
+  // 创建Tokenizer对象，词法规则保留一份用于写入缓存
+  tokenizer::Tokenizer tokenizer(lexer.value(), std::move(source.value()));
+  tokenizer.set_error_tolerant(tolerant);
+  tokenizer.set_utf8(utf8);
 
   // 输出所有token
   std::cout << "Tokens from file: " << input_file << std::endl;
   std::cout << "----------------------------------------" << std::endl;
 
-  int token_count = 0;
-  std::vector<tokenizer::Token> tokens;
-  while (true) {
-    auto token = tokenizer.next_token();
-    if (!token) {
-      break; // 没有更多token
-    }
-
-    std::cout << "[" << token_count << "]" << token->to_string() << std::endl;
-    tokens.push_back(*token);
-    token_count++;
+  tokenizer::TokenStream tokens =
+      parallel ? tokenizer.tokenize_parallel() : tokenizer.tokenize();
+  size_t token_count = tokens.size();
+  for (size_t i = 0; i < token_count; i++) {
+    std::cout << "[" << i << "]" << tokenizer.to_token(tokens.at(i)).to_string()
+              << std::endl;
   }
 
   std::cout << "----------------------------------------" << std::endl;
   std::cout << "Total tokens: " << token_count << std::endl;
 
-  // 创建SLR1解析器
-  std::cout << "\nInitializing SLR1 Parser..." << std::endl;
-  grammar::Grammar grammar(grammar_rules.value());
-  auto undefined_non_terminals = grammar.find_undefined_non_terminals();
-
-  if (!undefined_non_terminals.empty()) {
-    std::cerr << "语法中存在未定义的非终结符：";
-    for (const auto &nt : undefined_non_terminals) {
-      std::cerr << nt.to_string() << " ";
+  const auto &diagnostics = tokenizer.get_diagnostics();
+  if (!diagnostics.empty()) {
+    for (const auto &diagnostic : diagnostics) {
+      auto location = tokenizer.locate(diagnostic.offset);
+      std::cerr << "Error: " << diagnostic.describe() << " at line "
+                << location.line << ", column " << location.column
+                << (diagnostic.in_char_mode ? " in char mode" : "")
+                << std::endl;
     }
-    std::cerr << std::endl;
+    std::cerr << "词法分析发现 " << diagnostics.size() << " 处错误"
+              << std::endl;
     return 1;
   }
 
-  slr::SLR1Parser parser(grammar);
+  // 创建SLR1解析器
+  std::cout << "\nInitializing SLR1 Parser..." << std::endl;
+  std::optional<slr::SLR1Parser> parser;
+  if (cache) {
+    std::cout << "使用开始符号: " << start_symbol << std::endl;
+    parser.emplace(cache->parser());
+  } else {
+    auto undefined_non_terminals = grammar->find_undefined_non_terminals();
+
+    if (!undefined_non_terminals.empty()) {
+      std::cerr << "语法中存在未定义的非终结符：";
+      for (const auto &nt : undefined_non_terminals) {
+        std::cerr << nt.to_string() << " ";
+      }
+      std::cerr << std::endl;
+      return 1;
+    }
+
+    parser.emplace(*grammar);
 
-  // 允许用户指定开始符号
-  std::string start_symbol = "program";
-  std::cout << "使用开始符号: " << start_symbol << std::endl;
+    // 允许用户指定开始符号
+    std::cout << "使用开始符号: " << start_symbol << std::endl;
 
-  // 构建SLR1分析表
-  if (!parser.build_parse_table(start_symbol)) {
-    std::cerr << "构建SLR1分析表失败！" << std::endl;
-    return 1;
-  }
+    // 构建SLR1分析表
+    if (!parser->build_parse_table(start_symbol, mode)) {
+      std::cerr << "构建SLR1分析表失败！" << std::endl;
+      return 1;
+    }
+
+    // 打印SLR1分析表
+    // parser->print_parse_table();
+
+    // 导出解析表和项目集为JSON
+    std::ofstream parser_json("slr_parser.json");
+    parser_json << parser->to_json();
+    parser_json.close();
+    std::cout << "SLR parser data saved to slr_parser.json" << std::endl;
+    // 项目集只用于导出，解析只需要分析表
+    parser->release_item_sets();
 
-  // 打印SLR1分析表
-  // parser.print_parse_table();
-
-  // 导出解析表和项目集为JSON
-  std::ofstream parser_json("slr_parser.json");
-  parser_json << parser.to_json();
-  parser_json.close();
-  std::cout << "SLR parser data saved to slr_parser.json" << std::endl;
-
-  // 将token转换为SLRSymbol
-  std::vector<slr::SLRSymbol> symbols;
-  for (const auto &token : tokens) {
-    slr::SLRSymbol symbol(token.get_terminal().value,
-                          slr::SLRSymbolType::TERMINAL);
-    symbols.push_back(symbol);
+    // 写入失败只影响下次启动，不影响本次解析
+    slr::ParserCache::write(cache_file, cache_key, *parser, *lexer);
   }
 
   // 解析token序列
   std::cout << "\n开始解析输入..." << std::endl;
   slr::CSTNode root(slr::SLRSymbol("", slr::SLRSymbolType::NON_TERMINAL));
-  bool success = parser.parse(symbols, root);
+  // 文法符号到此全部就绪，冻结符号表，解析与导出时取符号名不再加锁
+  grammar::SymbolTable::global().freeze();
+  bool success = parser->parse(tokens, root);
 
   if (success) {
     std::cout << "解析成功！" << std::endl;
@@ -10,12 +10,15 @@
 #include <stack>
 
 namespace slr {
-// 解析输入符号序列
-bool SLR1Parser::parse(const std::vector<SLRSymbol> &input, CSTNode &root) {
-  // 添加结束符号
-  std::vector<SLRSymbol> input_with_eos = input;
-  input_with_eos.push_back(SLRSymbol::get_eos_symbol());
-
+// 解析主循环，class_at(i) 返回第 i 个输入的终结符类，越界时为结束符号的类
+// symbol_at(i) 返回第 i 个输入符号的显示文本，只在报错时调用
+// leaf_at(i) 返回移进第 i 个输入时放入语法树的叶子
+// describe(i) 返回第 i 个输入位置的描述，只在报错时调用
+template <typename ClassAt, typename SymbolAt, typename LeafAt,
+          typename Describe>
+bool SLR1Parser::parse_symbols(ClassAt class_at, SymbolAt symbol_at,
+                               LeafAt leaf_at, Describe describe,
+                               CSTNode &root) {
   // 状态栈和符号栈
   std::stack<int> state_stack;
   std::stack<CSTNode> symbol_stack;
@@ -27,37 +30,118 @@ bool SLR1Parser::parse(const std::vector<SLRSymbol> &input, CSTNode &root) {
 
   while (true) {
     int current_state = state_stack.top();
-    SLRSymbol current_symbol = input_with_eos[input_pos];
 
-    // 查找ACTION
-    if (action_table[current_state].find(current_symbol) ==
-        action_table[current_state].end()) {
-      return handle_error(current_state, current_symbol, input_pos);
+    // 一致状态直接按默认归约，否则按向前看符号查找ACTION
+    int16_t action = tables.default_action(current_state);
+    if (action == ParseTables::ERROR) {
+      action = tables.action_at(current_state, class_at(input_pos));
     }
 
-    Action action = action_table[current_state][current_symbol];
-
-    // 根据动作类型执行操作
-    switch (action.type) {
-    case ActionType::SHIFT:
-      perform_shift(action.value, current_symbol, state_stack, symbol_stack,
+    // 根据动作执行操作
+    if (action > 0) {
+      perform_shift(action, leaf_at(input_pos), state_stack, symbol_stack,
                     input_pos);
-      break;
-
-    case ActionType::REDUCE:
-      if (!perform_reduce(action.value, state_stack, symbol_stack, input_pos)) {
+    } else if (action < ParseTables::ACCEPT) {
+      if (!perform_reduce(ParseTables::reduced_production(action),
+                          state_stack, symbol_stack, input_pos)) {
         return false;
       }
-      break;
-
-    case ActionType::ACCEPT:
+    } else if (action == ParseTables::ACCEPT) {
       return perform_accept(symbol_stack, root, input_pos);
-
-    case ActionType::ERROR:
-      return handle_error(current_state, current_symbol, input_pos);
+    } else {
+      return handle_error(current_state, symbol_at(input_pos),
+                          describe(input_pos));
     }
   }
 
   return false; // 不应该到达这里
 }
+
+// 解析输入符号序列
+bool SLR1Parser::parse(const std::vector<SLRSymbol> &input, CSTNode &root) {
+  // 末尾添加结束符号
+  auto symbol_at = [&](size_t i) {
+    return i < input.size() ? input[i] : SLRSymbol::get_eos_symbol();
+  };
+  return parse_symbols(
+      [&](size_t i) {
+        auto it = compiled->terminal_index.find(symbol_at(i));
+        return it != compiled->terminal_index.end()
+                   ? tables.class_of(it->second)
+                   : ParseTables::NO_CLASS;
+      },
+      [&](size_t i) { return symbol_at(i).to_string(); },
+      [&](size_t i) { return CSTNode(input[i]); },
+      [](size_t i) { return "position " + std::to_string(i); }, root);
+}
+
+// 直接解析token流
+// 输入文本不放入全局符号表：字符模式下的普通字符只查找已有的文法终结符，
+// 词法记号的文本保存在叶子中
+bool SLR1Parser::parse(const tokenizer::TokenStream &input, CSTNode &root) {
+  // 字符模式下的普通字符对应的文法终结符下标，不是文法终结符时为空
+  auto plain_terminal = [&](size_t i) -> std::optional<size_t> {
+    auto id = grammar::SymbolTable::global().find(input.text(i));
+    if (!id) {
+      return std::nullopt;
+    }
+    auto it = compiled->terminal_index.find(
+        SLRSymbol(*id, SLRSymbolType::TERMINAL));
+    if (it == compiled->terminal_index.end()) {
+      return std::nullopt;
+    }
+    return it->second;
+  };
+  return parse_symbols(
+      [&](size_t i) {
+        // 终结符编号与分析表的终结符下标一致，结束符号排在最后
+        if (i >= input.size()) {
+          return tables.class_of(compiled->eos());
+        }
+        uint16_t id = input.terminal_ids[i];
+        if (id < terminal_symbols.size()) {
+          return tables.class_of(id);
+        }
+        // 字符模式下的普通字符：单字节查表，其余按文本查找
+        auto text = input.text(i);
+        if (text.size() == 1) {
+          return tables.byte_class[static_cast<unsigned char>(text[0])];
+        }
+        auto terminal = plain_terminal(i);
+        return terminal ? tables.class_of(*terminal) : ParseTables::NO_CLASS;
+      },
+      [&](size_t i) {
+        if (i >= input.size()) {
+          return SLRSymbol::get_eos_symbol().to_string();
+        }
+        uint16_t id = input.terminal_ids[i];
+        if (id < terminal_symbols.size()) {
+          return terminal_symbols[id].to_string();
+        }
+        return "'" + std::string(input.text(i)) + "'";
+      },
+      [&](size_t i) {
+        uint16_t id = input.terminal_ids[i];
+        if (id >= terminal_symbols.size()) {
+          // 能够移进的普通字符一定是文法终结符
+          return CSTNode(compiled->terminals[*plain_terminal(i)]);
+        }
+        // 词法记号的叶子是其识别到的文本
+        const SLRSymbol &symbol = terminal_symbols[id];
+        if (symbol.type == SLRSymbolType::SPECIAL_TERMINAL) {
+          return CSTNode(symbol, tokenizer::strip_layout(input.text(i)));
+        }
+        return CSTNode(symbol);
+      },
+      [&](size_t i) {
+        // 出错时才建立行首偏移表，按token在输入源中的偏移给出行号与列号
+        size_t offset =
+            i < input.size() ? input.offsets[i] : input.source.size();
+        auto location = tokenizer::LineIndex(input.source).locate(offset);
+        return "line " + std::to_string(location.line) + ", column " +
+               std::to_string(location.column) + " (token " +
+               std::to_string(i) + ")";
+      },
+      root);
+}
 } // namespace slr
\ No newline at end of file
@@ -0,0 +1,296 @@
+#include "../include/slr_parser.hpp"
+#include <algorithm>
+#include <queue>
+
+namespace slr {
+
+namespace {
+
+// 有向图的强连通分量（迭代式 Tarjan），只返回构成环的分量
+// 自环的单个结点也算作环
+std::vector<std::vector<uint32_t>>
+find_cycles(const std::vector<std::vector<uint32_t>> &edges) {
+  const uint32_t unvisited = UINT32_MAX;
+  size_t n = edges.size();
+  std::vector<uint32_t> index(n, unvisited), low(n, 0);
+  std::vector<bool> on_stack(n, false);
+  std::vector<uint32_t> stack;
+  // 调用栈：结点与下一条待访问边的位置
+  std::vector<std::pair<uint32_t, size_t>> frames;
+  std::vector<std::vector<uint32_t>> cycles;
+  uint32_t next_index = 0;
+
+  for (uint32_t root = 0; root < n; root++) {
+    if (index[root] != unvisited) {
+      continue;
+    }
+    frames.emplace_back(root, 0);
+    index[root] = low[root] = next_index++;
+    stack.push_back(root);
+    on_stack[root] = true;
+
+    while (!frames.empty()) {
+      auto &[node, edge] = frames.back();
+      if (edge < edges[node].size()) {
+        uint32_t next = edges[node][edge++];
+        if (index[next] == unvisited) {
+          index[next] = low[next] = next_index++;
+          stack.push_back(next);
+          on_stack[next] = true;
+          frames.emplace_back(next, 0);
+        } else if (on_stack[next]) {
+          low[node] = std::min(low[node], index[next]);
+        }
+        continue;
+      }
+
+      uint32_t finished = node;
+      frames.pop_back();
+      if (!frames.empty()) {
+        uint32_t parent = frames.back().first;
+        low[parent] = std::min(low[parent], low[finished]);
+      }
+      if (low[finished] != index[finished]) {
+        continue;
+      }
+      std::vector<uint32_t> component;
+      uint32_t member;
+      do {
+        member = stack.back();
+        stack.pop_back();
+        on_stack[member] = false;
+        component.push_back(member);
+      } while (member != finished);
+      bool self_loop =
+          std::find(edges[finished].begin(), edges[finished].end(),
+                    finished) != edges[finished].end();
+      if (component.size() > 1 || self_loop) {
+        std::sort(component.begin(), component.end());
+        cycles.push_back(std::move(component));
+      }
+    }
+  }
+
+  std::sort(cycles.begin(), cycles.end());
+  return cycles;
+}
+
+// 输出 flags 中取值为 value 的非终结符名
+void print_names(std::ostream &out, const CompiledGrammar &grammar,
+                 const std::vector<bool> &flags, bool value) {
+  for (size_t i = 0; i < flags.size(); i++) {
+    if (flags[i] == value) {
+      out << " " << grammar::NonTerminal(grammar.non_terminals[i]).to_string();
+    }
+  }
+}
+
+} // namespace
+
+GrammarAnalysis GrammarAnalysis::analyze(const CompiledGrammar &grammar) {
+  size_t n = grammar.non_terminals.size();
+  size_t m = grammar.productions.size();
+  GrammarAnalysis result;
+  result.productive.assign(n, false);
+  result.reachable.assign(n, false);
+  result.nullable.assign(n, false);
+
+  // 右部中每次出现非终结符都记录一次所在的产生式
+  // pending[p] 为产生式 p 右部中尚未满足条件的非终结符出现次数
+  std::vector<std::vector<uint32_t>> occurrences(n);
+  std::vector<uint32_t> pending(m, 0);
+  std::vector<bool> has_terminal(m, false);
+  std::vector<bool> has_undefined(m, false);
+  std::unordered_set<grammar::SymbolId> undefined_seen;
+
+  for (size_t p = 0; p < m; p++) {
+    for (const auto &symbol : grammar.rhs(p)) {
+      if (is_terminal(symbol.type)) {
+        has_terminal[p] = true;
+        continue;
+      }
+      auto index = grammar.find_non_terminal(symbol.id);
+      if (!index) {
+        has_undefined[p] = true;
+        if (undefined_seen.insert(symbol.id).second) {
+          result.undefined.push_back(symbol.id);
+        }
+        continue;
+      }
+      occurrences[*index].push_back(static_cast<uint32_t>(p));
+      pending[p]++;
+    }
+  }
+
+  // 满足条件的非终结符逐个出队，只递减引用它的产生式的计数
+  // 计数归零的产生式使其左部满足条件，每个出现处只处理一次
+  auto propagate = [&](std::vector<bool> &flags, auto usable) {
+    std::vector<uint32_t> counts = pending;
+    std::queue<uint32_t> worklist;
+    auto fire = [&](size_t p) {
+      uint32_t left = grammar.productions[p].non_terminal;
+      if (!flags[left]) {
+        flags[left] = true;
+        worklist.push(left);
+      }
+    };
+    for (size_t p = 0; p < m; p++) {
+      if (counts[p] == 0 && usable(p)) {
+        fire(p);
+      }
+    }
+    while (!worklist.empty()) {
+      uint32_t nt = worklist.front();
+      worklist.pop();
+      for (uint32_t p : occurrences[nt]) {
+        if (--counts[p] == 0 && usable(p)) {
+          fire(p);
+        }
+      }
+    }
+  };
+
+  propagate(result.productive, [&](size_t p) { return !has_undefined[p]; });
+  propagate(result.nullable,
+            [&](size_t p) { return !has_undefined[p] && !has_terminal[p]; });
+
+  // 可达性只沿右部全部可产生的产生式传播
+  auto usable = [&](size_t p) {
+    if (has_undefined[p]) {
+      return false;
+    }
+    for (const auto &symbol : grammar.rhs(p)) {
+      if (is_non_terminal(symbol.type) &&
+          !result.productive[*grammar.find_non_terminal(symbol.id)]) {
+        return false;
+      }
+    }
+    return true;
+  };
+  if (n > 0 && result.productive[0]) {
+    std::queue<uint32_t> worklist;
+    result.reachable[0] = true;
+    worklist.push(0);
+    while (!worklist.empty()) {
+      uint32_t nt = worklist.front();
+      worklist.pop();
+      for (uint32_t p = grammar.production_begin[nt];
+           p < grammar.production_begin[nt + 1]; p++) {
+        if (!usable(p)) {
+          continue;
+        }
+        for (const auto &symbol : grammar.rhs(p)) {
+          if (is_terminal(symbol.type)) {
+            continue;
+          }
+          uint32_t next = *grammar.find_non_terminal(symbol.id);
+          if (!result.reachable[next]) {
+            result.reachable[next] = true;
+            worklist.push(next);
+          }
+        }
+      }
+    }
+  }
+
+  // A 的产生式中经可空前缀可以到达 B 时有左调用边 A -> B，右调用边对称
+  std::vector<std::vector<uint32_t>> left_edges(n), right_edges(n);
+  auto add_edges = [&](auto begin, auto end, std::vector<uint32_t> &edges) {
+    for (auto it = begin; it != end; ++it) {
+      if (is_terminal(it->type)) {
+        break;
+      }
+      auto index = grammar.find_non_terminal(it->id);
+      if (!index) {
+        break;
+      }
+      edges.push_back(*index);
+      if (!result.nullable[*index]) {
+        break;
+      }
+    }
+  };
+  for (size_t p = 0; p < m; p++) {
+    auto right = grammar.rhs(p);
+    uint32_t left = grammar.productions[p].non_terminal;
+    add_edges(right.begin(), right.end(), left_edges[left]);
+    add_edges(right.rbegin(), right.rend(), right_edges[left]);
+  }
+
+  auto to_names = [&](const std::vector<std::vector<uint32_t>> &cycles) {
+    std::vector<std::vector<grammar::SymbolId>> named;
+    for (const auto &cycle : cycles) {
+      std::vector<grammar::SymbolId> names;
+      for (uint32_t nt : cycle) {
+        names.push_back(grammar.non_terminals[nt]);
+      }
+      named.push_back(std::move(names));
+    }
+    return named;
+  };
+  result.left_recursive = to_names(find_cycles(left_edges));
+  result.right_recursive = to_names(find_cycles(right_edges));
+
+  return result;
+}
+
+std::vector<bool> GrammarAnalysis::useful() const {
+  std::vector<bool> keep(productive.size());
+  for (size_t i = 0; i < keep.size(); i++) {
+    keep[i] = productive[i] && reachable[i];
+  }
+  return keep;
+}
+
+bool GrammarAnalysis::has_useless_symbols() const {
+  auto keep = useful();
+  return !undefined.empty() ||
+         std::find(keep.begin(), keep.end(), false) != keep.end();
+}
+
+void GrammarAnalysis::print_report(const CompiledGrammar &grammar,
+                                   std::ostream &out) const {
+  out << "文法分析：" << grammar.non_terminals.size() << " 个非终结符，"
+      << grammar.productions.size() << " 个产生式" << std::endl;
+  if (!undefined.empty()) {
+    out << "未定义的非终结符：";
+    for (auto name : undefined) {
+      out << " " << grammar::NonTerminal(name).to_string();
+    }
+    out << std::endl;
+  }
+  if (std::find(productive.begin(), productive.end(), false) !=
+      productive.end()) {
+    out << "不可产生的非终结符：";
+    print_names(out, grammar, productive, false);
+    out << std::endl;
+  }
+  std::vector<bool> unreachable(reachable.size());
+  for (size_t i = 0; i < reachable.size(); i++) {
+    unreachable[i] = productive[i] && !reachable[i];
+  }
+  if (std::find(unreachable.begin(), unreachable.end(), true) !=
+      unreachable.end()) {
+    out << "不可达的非终结符：";
+    print_names(out, grammar, unreachable, true);
+    out << std::endl;
+  }
+  if (std::find(nullable.begin(), nullable.end(), true) != nullable.end()) {
+    out << "可空的非终结符：";
+    print_names(out, grammar, nullable, true);
+    out << std::endl;
+  }
+  auto print_cycles = [&](const char *title, const auto &cycles) {
+    for (const auto &cycle : cycles) {
+      out << title;
+      for (auto name : cycle) {
+        out << " " << grammar::NonTerminal(name).to_string();
+      }
+      out << std::endl;
+    }
+  };
+  print_cycles("左递归：", left_recursive);
+  print_cycles("右递归：", right_recursive);
+}
+
+} // namespace slr
@@ -40,7 +40,7 @@ process_children(const std::vector<CSTNode> &children,
 ASTNode CSTNode::to_ast() const {
   std::vector<ASTNode> children;
   if (!production.has_value()) {
-    return ASTNode{symbol, {}, production};
+    return ASTNode(symbol, text);
   }
 
   // Use the unified helper function to process child nodes
@@ -67,7 +67,7 @@ std::string ASTNode::to_json() const {
                       symbol.type == SLRSymbolType::SPECIAL_TERMINAL
                   ? "terminal"
                   : "non-terminal";
-  j["value"] = symbol.value;
+  j["value"] = value();
   // 要带上语义信息
   j["sematic"] = "";
   if (production.has_value()) {
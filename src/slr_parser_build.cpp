@@ -7,6 +7,7 @@
 #include <queue>
 #include <sstream>
 #include <stack>
+#include <thread>
 
 namespace slr {
 
@@ -28,356 +29,225 @@ std::string CSTNode::to_json() const {
                       symbol.type == SLRSymbolType::SPECIAL_TERMINAL
                   ? "terminal"
                   : "non-terminal";
-  j["value"] = symbol.value;
+  j["value"] = value();
 
   // 返回格式化的JSON字符串
   return j.dump(2); // 缩进2个空格，使输出更易读
 }
 
-// Helper function to process items in the closure
-std::unordered_set<LR0Item>
-process_closure_item(const LR0Item &current,
-                     const std::vector<Production> &productions) {
-  std::unordered_set<LR0Item> new_items;
-  if (current.dot_position < current.production.size() &&
-      is_non_terminal(current.production[current.dot_position].type)) {
-    std::string nt_name = current.production[current.dot_position].value;
-
-    for (const auto &prod : productions) {
-      if (prod.left == nt_name) {
-        LR0Item new_item(nt_name, prod.right, 0);
-        new_items.insert(new_item);
-      }
+// 核心项目之外，点后是非终结符 B 时并入 B 的预计算闭包集合
+// 位集中的产生式都以点在开头的项目加入，按编号有序，与核心项目归并即可
+void SLR1Parser::closure(const std::vector<LR0Item> &kernel,
+                         std::vector<LR0Item> &items, Bitset &scratch) const {
+  const auto &flat = *compiled;
+  scratch.clear();
+  for (const auto &item : kernel) {
+    const auto &entry = flat.productions[item.production];
+    if (item.dot_position >= entry.length) {
+      continue;
     }
-  }
-  return new_items;
-}
-
-// Refactored closure function
-std::unordered_set<LR0Item>
-SLR1Parser::closure(const std::unordered_set<LR0Item> &items) {
-  std::unordered_set<LR0Item> result = items;
-  std::queue<LR0Item> queue;
-
-  for (const auto &item : items) {
-    queue.push(item);
-  }
-
-  while (!queue.empty()) {
-    LR0Item current = queue.front();
-    queue.pop();
-
-    auto new_items = process_closure_item(current, productions);
-    for (const auto &new_item : new_items) {
-      if (result.find(new_item) == result.end()) {
-        result.insert(new_item);
-        queue.push(new_item);
-      }
+    uint32_t position = entry.offset + item.dot_position;
+    if (is_non_terminal(flat.symbols[position].type)) {
+      scratch.merge(closure_sets[flat.symbol_index[position]]);
     }
   }
 
-  return result;
-}
-
-// Refactored go_to function
-std::unordered_set<LR0Item>
-SLR1Parser::go_to(const std::unordered_set<LR0Item> &items,
-                  const SLRSymbol &symbol) {
-  std::unordered_set<LR0Item> result;
-
-  for (const auto &item : items) {
-    if (item.dot_position < item.production.size() &&
-        item.production[item.dot_position] == symbol) {
-      LR0Item new_item(item.non_terminal, item.production,
-                       item.dot_position + 1);
-      result.insert(new_item);
+  items.clear();
+  auto next = kernel.begin();
+  scratch.for_each([&](size_t p) {
+    LR0Item item{static_cast<uint32_t>(p), 0};
+    while (next != kernel.end() && *next < item) {
+      items.push_back(*next++);
     }
-  }
-
-  return closure(result);
+    if (next != kernel.end() && *next == item) {
+      ++next;
+    }
+    items.push_back(item);
+  });
+  items.insert(items.end(), next, kernel.end());
 }
 
-// Helper function to process symbols for GOTO calculation
-std::unordered_set<SLRSymbol>
-process_symbols_for_goto(const std::unordered_set<LR0Item> &items) {
-  std::unordered_set<SLRSymbol> symbols;
-  for (const auto &item : items) {
-    if (item.dot_position < item.production.size()) {
-      symbols.insert(item.production[item.dot_position]);
-    }
+size_t hash_kernel(const std::vector<LR0Item> &kernel) {
+  size_t h = kernel.size();
+  for (const auto &item : kernel) {
+    h ^= std::hash<LR0Item>{}(item) + 0x9e3779b9 + (h << 6) + (h >> 2);
   }
-  return symbols;
+  return h;
 }
 
-// Refactored build_item_sets function
-void SLR1Parser::build_item_sets() {
-  // 清空现有项目集族
-  item_sets.clear();
-
-  // 创建初始项目集
-  std::unordered_set<LR0Item> initial_item;
-
-  // 添加增广文法的起始项目
-  for (size_t i = 0; i < productions.size(); ++i) {
-    if (productions[i].left == augmented_start_symbol) {
-      initial_item.insert(
-          LR0Item(augmented_start_symbol, productions[i].right, 0));
-      break;
+// 按点后的符号对闭包项目分组，每组前移后的项目即一个转移的目标核心
+// 分组按符号编号排序，组内项目有序；点在末尾的项目只记录产生式编号
+void SLR1Parser::expand_state(const std::vector<LR0Item> &kernel,
+                              StateScratch &scratch,
+                              std::vector<Successor> &successors,
+                              std::vector<uint32_t> &complete) const {
+  const auto &flat = *compiled;
+  closure(kernel, scratch.items, scratch.added);
+
+  auto &moves = scratch.moves;
+  moves.clear();
+  complete.clear();
+  for (const auto &item : scratch.items) {
+    const auto &entry = flat.productions[item.production];
+    if (item.dot_position == entry.length) {
+      complete.push_back(item.production);
+      continue;
     }
+    moves.emplace_back(flat.symbols[entry.offset + item.dot_position],
+                       LR0Item{item.production, item.dot_position + 1});
   }
-
-  // 计算初始项目集的闭包
-  std::unordered_set<LR0Item> initial_closure = closure(initial_item);
-
-  // 将初始闭包加入项目集族
-  item_sets.push_back(initial_closure);
-
-  // 用于跟踪已处理的项目集
-  std::unordered_set<std::string> processed_sets;
-
-  // 处理队列
-  std::queue<int> queue;
-  queue.push(0); // 从初始状态开始
-
-  while (!queue.empty()) {
-    int current_state = queue.front();
-    queue.pop();
-
-    // 获取当前项目集的字符串表示，用于检查是否已处理
-    std::string set_str;
-    for (const auto &item : item_sets[current_state]) {
-      set_str += item.to_string() + "\n";
+  std::sort(moves.begin(), moves.end(), [](const auto &a, const auto &b) {
+    if (a.first.id != b.first.id) {
+      return a.first.id < b.first.id;
     }
-
-    if (processed_sets.find(set_str) != processed_sets.end()) {
-      continue; // 已处理过此项目集
+    if (a.first.type != b.first.type) {
+      return a.first.type < b.first.type;
     }
-
-    processed_sets.insert(set_str);
-
-    // 使用helper函数处理符号
-    auto symbols = process_symbols_for_goto(item_sets[current_state]);
-
-    for (const auto &symbol : symbols) {
-      std::unordered_set<LR0Item> next_set =
-          go_to(item_sets[current_state], symbol);
-
-      if (next_set.empty()) {
-        continue; // 空集，跳过
-      }
-
-      bool found = false;
-      int next_state = -1;
-
-      for (size_t i = 0; i < item_sets.size(); ++i) {
-        if (item_sets[i] == next_set) {
-          found = true;
-          next_state = i;
-          break;
-        }
-      }
-
-      if (!found) {
-        next_state = item_sets.size();
-        item_sets.push_back(next_set);
-        queue.push(next_state);
-      }
-
-      goto_table[current_state][symbol] = next_state;
+    return a.second < b.second;
+  });
+
+  successors.clear();
+  for (size_t begin = 0; begin < moves.size();) {
+    size_t end = begin;
+    std::vector<LR0Item> target;
+    while (end < moves.size() && moves[end].first == moves[begin].first) {
+      target.push_back(moves[end].second);
+      end++;
     }
+    successors.emplace_back(moves[begin].first, std::move(target));
+    begin = end;
   }
 }
 
-// 计算FIRST集合
-void SLR1Parser::compute_first_sets() {
-  first_sets.clear();
-
-  // 初始化：所有终结符的FIRST集合就是它们自己
-  for (const auto &prod : productions) {
-    for (const auto &symbol : prod.right) {
-      if (is_terminal(symbol.type)) {
-        first_sets[symbol.value].insert(symbol);
-      }
-    }
+// 状态以排好序的核心项目标识，按核心的散列值查找已有状态
+// 状态按发现顺序编号，同一状态的转移按符号编号依次生成目标状态
+void SLR1Parser::build_item_sets(size_t thread_count) {
+  const auto &flat = *compiled;
+  compute_closure_sets();
+  if (thread_count == 0) {
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
   }
-
-  // 初始化：所有非终结符的FIRST集合为空
-  for (const auto &prod : productions) {
-    if (first_sets.find(prod.left) == first_sets.end()) {
-      first_sets[prod.left] = std::unordered_set<SLRSymbol>();
-    }
+  thread_count = std::min(thread_count, flat.productions.size() /
+                                            MIN_PRODUCTIONS_PER_THREAD);
+  if (thread_count > 1) {
+    build_item_sets_parallel(thread_count);
+    return;
   }
 
-  bool changed = true;
-  while (changed) {
-    changed = false;
-
-    for (const auto &prod : productions) {
-      std::string nt = prod.left;
-      const auto &rhs = prod.right;
-
-      // 如果产生式为空，跳过
-      if (rhs.empty()) {
-        continue;
-      }
-
-      // 获取当前FIRST集合大小
-      size_t original_size = first_sets[nt].size();
-
-      // 计算产生式右侧的FIRST集合
-      auto rhs_first = get_first_of_sequence(rhs);
-
-      // 将右侧FIRST集合添加到非终结符的FIRST集合
-      for (const auto &symbol : rhs_first) {
-        first_sets[nt].insert(symbol);
-      }
-
-      // 检查是否有变化
-      if (first_sets[nt].size() > original_size) {
-        changed = true;
+  kernels.clear();
+  transitions.clear();
+  reductions.clear();
+
+  std::unordered_multimap<size_t, uint32_t> kernel_index;
+  auto intern = [&](std::vector<LR0Item> kernel) {
+    size_t h = hash_kernel(kernel);
+    auto [begin, end] = kernel_index.equal_range(h);
+    for (auto it = begin; it != end; ++it) {
+      if (kernels[it->second] == kernel) {
+        return it->second;
       }
     }
+    auto state = static_cast<uint32_t>(kernels.size());
+    kernels.push_back(std::move(kernel));
+    kernel_index.emplace(h, state);
+    return state;
+  };
+
+  // 初始状态的核心为 S' -> .开始符号
+  intern({LR0Item{0, 0}});
+
+  StateScratch scratch(flat.productions.size());
+  std::vector<Successor> successors;
+  for (size_t state = 0; state < kernels.size(); state++) {
+    std::vector<uint32_t> complete;
+    expand_state(kernels[state], scratch, successors, complete);
+
+    std::vector<std::pair<SLRSymbol, int>> targets;
+    for (auto &[symbol, kernel] : successors) {
+      targets.emplace_back(symbol,
+                           static_cast<int>(intern(std::move(kernel))));
+    }
+    transitions.push_back(std::move(targets));
+    reductions.push_back(std::move(complete));
   }
+  state_count = kernels.size();
 }
 
-// 获取符号的FIRST集合
-std::unordered_set<SLRSymbol> SLR1Parser::get_first(const SLRSymbol &symbol) {
-  if (is_terminal(symbol.type)) {
-    return {symbol};
-  } else {
-    return first_sets[symbol.value];
-  }
-}
-
-// 获取符号序列的FIRST集合
-std::unordered_set<SLRSymbol>
-SLR1Parser::get_first_of_sequence(const std::vector<SLRSymbol> &symbols,
-                                  size_t start_pos) {
-  std::unordered_set<SLRSymbol> result;
-
-  if (start_pos >= symbols.size()) {
-    return result;
-  }
-
-  // 获取第一个符号的FIRST集合
-  auto first = get_first(symbols[start_pos]);
-  result.insert(first.begin(), first.end());
-
-  return result;
+void SLR1Parser::release_item_sets() {
+  kernels = {};
+  transitions = {};
+  reductions = {};
+  closure_sets = {};
+  lookaheads = {};
 }
 
-// 计算FOLLOW集合
-void SLR1Parser::compute_follow_sets() {
-  follow_sets.clear();
-
-  // 初始化：所有非终结符的FOLLOW集合为空
-  for (const auto &prod : productions) {
-    follow_sets[prod.left] = std::unordered_set<SLRSymbol>();
+// 将语法规则转换为增广文法
+bool SLR1Parser::initialize_augment_grammar() {
+  // 设置增广文法的起始符号
+  augmented_start_symbol = grammar::intern_symbol("S'");
+
+  // 按语法文件中的顺序编号产生式，编号与散列表的遍历顺序无关
+  auto flat = CompiledGrammar::compile(grammar, start_symbol,
+                                       augmented_start_symbol);
+
+  // 构造自动机之前剪除未定义、不可产生或不可达的非终结符
+  analysis = GrammarAnalysis::analyze(flat);
+  if (!analysis.productive[0]) {
+    std::cerr << "开始符号 " << grammar::NonTerminal(start_symbol).to_string()
+              << " 不能推导出任何终结符串" << std::endl;
+    return false;
   }
-
-  // 将#加入到增广文法起始符号的FOLLOW集合
-  SLRSymbol eos = SLRSymbol::get_eos_symbol();
-  follow_sets[augmented_start_symbol].insert(eos);
-
-  bool changed = true;
-  while (changed) {
-    changed = false;
-
-    for (const auto &prod : productions) {
-      std::string nt = prod.left;
-      const auto &rhs = prod.right;
-
-      for (size_t i = 0; i < rhs.size(); ++i) {
-        // 如果是非终结符
-        if (is_non_terminal(rhs[i].type)) {
-          std::string B = rhs[i].value;
-          size_t original_size = follow_sets[B].size();
-
-          // 如果B后面有符号
-          if (i + 1 < rhs.size()) {
-            // 将FIRST(β)加入FOLLOW(B)
-            auto first_beta = get_first_of_sequence(rhs, i + 1);
-            for (const auto &symbol : first_beta) {
-              follow_sets[B].insert(symbol);
-            }
-          }
-
-          // 如果B是最后一个符号或者后面的符号都可以推导出空
-          if (i == rhs.size() - 1) {
-            // 将FOLLOW(A)加入FOLLOW(B)
-            for (const auto &symbol : follow_sets[nt]) {
-              follow_sets[B].insert(symbol);
-            }
-          }
-
-          // 检查是否有变化
-          if (follow_sets[B].size() > original_size) {
-            changed = true;
-          }
-        }
+  if (analysis.has_useless_symbols()) {
+    auto keep = analysis.useful();
+    std::cerr << "剪除无用的非终结符：";
+    for (size_t i = 0; i < keep.size(); i++) {
+      if (!keep[i]) {
+        std::cerr << " "
+                  << grammar::NonTerminal(flat.non_terminals[i]).to_string();
       }
     }
+    for (auto name : analysis.undefined) {
+      std::cerr << " " << grammar::NonTerminal(name).to_string();
+    }
+    std::cerr << std::endl;
+    flat = flat.prune(keep);
+    // 之后的FIRST、FOLLOW计算使用剪除后文法的可空信息
+    analysis = GrammarAnalysis::analyze(flat);
   }
-}
+  compiled = std::make_shared<const CompiledGrammar>(std::move(flat));
 
-// 将语法规则转换为增广文法
-void SLR1Parser::initialize_augment_grammar() {
   productions.clear();
-
-  // 设置增广文法的起始符号
-  augmented_start_symbol = "S'";
-
-  // 添加S'->S产生式
-  std::vector<SLRSymbol> new_prod;
-  new_prod.push_back(SLRSymbol(start_symbol, SLRSymbolType::NON_TERMINAL));
-  productions.push_back(
-      Production{augmented_start_symbol, new_prod, {0}, false, true, ""});
-
-  // 添加原始文法的产生式
-  for (const auto &rules_pair : grammar.rule_map) {
-    for (const auto &rule : rules_pair.second) {
-      for (const auto &prod : rule.right.production) {
-        std::vector<SLRSymbol> symbols;
-        std::vector<size_t> children_indices;
-        bool do_flatten = rule.ast_rule.do_flatten;
-        for (const auto &sym : prod) {
-          symbols.push_back(SLRSymbol(sym));
-        }
-        for (auto child : rule.ast_rule.children) {
-          children_indices.push_back(child);
-        }
-        productions.push_back(
-            Production{rule.left.name, symbols, children_indices, do_flatten,
-                       rule.ast_rule.use_all_children, rule.sematic_actions});
-      }
-    }
+  productions.reserve(compiled->productions.size());
+  for (size_t i = 0; i < compiled->productions.size(); ++i) {
+    productions.push_back(compiled->production(i));
   }
+  return true;
 }
 
-// Helper function to handle reduce actions
-void SLR1Parser::handle_reduce_action(size_t i, const LR0Item &item) {
-  int prod_index = -1;
-  for (size_t j = 0; j < productions.size(); ++j) {
-    if (productions[j].left == item.non_terminal &&
-        productions[j].right == item.production) {
-      prod_index = j;
-      break;
-    }
-  }
+namespace {
 
-  if (prod_index != -1) {
-    for (const auto &symbol : follow_sets[item.non_terminal]) {
-      if (action_table[i].find(symbol) != action_table[i].end() && (action_table[i][symbol].type!= ActionType::REDUCE || (action_table[i][symbol].type == ActionType::REDUCE && action_table[i][symbol].value!= prod_index))) {
-        std::cerr << "SLR冲突：状态" << i << "，符号" << symbol.to_string()
-                  << std::endl;
-        std::cerr << "现有动作：" << action_table[i][symbol].to_string()
-                  << std::endl;
-        std::cerr << "新动作：r" << prod_index << std::endl;
-      } else {
-        action_table[i][symbol] = Action(ActionType::REDUCE, prod_index);
-      }
+const char *conflict_title(ParserMode mode) {
+  return mode == ParserMode::LALR1 ? "LALR冲突：状态" : "SLR冲突：状态";
+}
+
+} // namespace
+
+// Helper function to handle reduce actions
+void SLR1Parser::handle_reduce_action(size_t i, uint32_t production,
+                                      const Bitset &lookahead) {
+  int prod_index = static_cast<int>(production);
+  lookahead.for_each([&](size_t terminal) {
+    const SLRSymbol &symbol = compiled->terminals[terminal];
+    if (action_table[i].find(symbol) != action_table[i].end() && (action_table[i][symbol].type!= ActionType::REDUCE || (action_table[i][symbol].type == ActionType::REDUCE && action_table[i][symbol].value!= prod_index))) {
+      std::cerr << conflict_title(mode) << i << "，符号" << symbol.to_string()
+                << std::endl;
+      std::cerr << "现有动作：" << action_table[i][symbol].to_string()
+                << std::endl;
+      std::cerr << "新动作：r" << prod_index << std::endl;
+    } else {
+      action_table[i][symbol] = Action(ActionType::REDUCE, prod_index);
     }
-  }
+  });
 }
 
 // Helper function to handle accept actions
@@ -389,7 +259,7 @@ void SLR1Parser::handle_accept_action(size_t i) {
 void SLR1Parser::handle_shift_action(size_t i, const SLRSymbol &symbol,
                                      int next_state) {
   if (action_table[i].find(symbol) != action_table[i].end() && (action_table[i][symbol].type != ActionType::SHIFT || (action_table[i][symbol].type == ActionType::SHIFT && action_table[i][symbol].value != next_state))) {
-    std::cerr << "SLR冲突：状态" << i << "，符号" << symbol.to_string()
+    std::cerr << conflict_title(mode) << i << "，符号" << symbol.to_string()
               << std::endl;
     std::cerr << "现有动作：" << action_table[i][symbol].to_string()
               << std::endl;
@@ -399,43 +269,31 @@ void SLR1Parser::handle_shift_action(size_t i, const SLRSymbol &symbol,
   }
 }
 
-// Refactored build_tables function with reduced nesting
+// 由LR(0)自动机的转移与归约项目填写分析表
+// 先填移进再填归约，移进-归约冲突时保留移进，归约-归约冲突时保留编号小的产生式
 void SLR1Parser::build_tables() {
   action_table.clear();
   goto_table.clear();
 
-  // 构建项目集族
-  build_item_sets();
-
-  // 计算FIRST和FOLLOW集合
-  compute_first_sets();
-  compute_follow_sets();
-
-  // 构建ACTION
-  for (size_t i = 0; i < item_sets.size(); ++i) {
-    const auto &item_set = item_sets[i];
-
-    for (const auto &item : item_set) {
-      // Guard clause for ACCEPT action
-      if (item.dot_position == item.production.size() &&
-          item.non_terminal == augmented_start_symbol) {
-        handle_accept_action(i);
-        continue;
-      }
-
-      // Guard clause for REDUCE action
-      if (item.dot_position == item.production.size()) {
-        handle_reduce_action(i, item);
-        continue;
+  for (size_t i = 0; i < state_count; ++i) {
+    for (const auto &[symbol, next_state] : transitions[i]) {
+      goto_table[i][symbol] = next_state;
+      if (is_terminal(symbol.type)) {
+        handle_shift_action(i, symbol, next_state);
       }
+    }
 
-      // Guard clause for SHIFT action
-      if (is_terminal(item.production[item.dot_position].type)) {
-        SLRSymbol symbol = item.production[item.dot_position];
-        if (goto_table[i].find(symbol) != goto_table[i].end()) {
-          int next_state = goto_table[i][symbol];
-          handle_shift_action(i, symbol, next_state);
-        }
+    for (size_t k = 0; k < reductions[i].size(); k++) {
+      uint32_t production = reductions[i][k];
+      // 增广产生式归约即接受
+      if (production == 0) {
+        handle_accept_action(i);
+      } else if (mode == ParserMode::LALR1) {
+        handle_reduce_action(i, production, lookaheads[i][k]);
+      } else {
+        handle_reduce_action(
+            i, production,
+            follow_sets[compiled->productions[production].non_terminal]);
       }
     }
   }
@@ -0,0 +1,614 @@
+#include "../include/slr_parser_cache.hpp"
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <set>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace slr {
+
+namespace {
+
+// 文件头，之后是各个数组
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order; // 按本机字节序写入的 BYTE_ORDER_MARK
+  uint64_t key;
+  uint64_t checksum; // 文件头之后全部内容的散列
+};
+
+constexpr char MAGIC[8] = {'S', 'G', 'O', 'T', 'A', 'B', 'L', 'E'};
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+size_t align8(size_t n) { return (n + 7) & ~size_t{7}; }
+
+uint64_t checksum(const char *data, size_t size) {
+  return grammar::hash_grammar_text(
+      std::string_view(data + sizeof(Header), size - sizeof(Header)));
+}
+
+// 依次追加数组：元素个数（uint64），元素，补齐到8字节
+class Writer {
+public:
+  std::string buffer;
+
+  template <typename T> void array(std::span<const T> values) {
+    uint64_t count = values.size();
+    buffer.append(reinterpret_cast<const char *>(&count), sizeof(count));
+    buffer.append(reinterpret_cast<const char *>(values.data()),
+                  values.size_bytes());
+    buffer.resize(align8(buffer.size()), '\0');
+  }
+
+  template <typename T> void array(const std::vector<T> &values) {
+    array(std::span<const T>(values));
+  }
+
+  void scalars(std::initializer_list<uint64_t> values) {
+    array(std::span<const uint64_t>(values.begin(), values.size()));
+  }
+};
+
+// 按写入的顺序读取数组，越界或长度不符时标记失败
+class Reader {
+private:
+  const char *data;
+  size_t size;
+  size_t position;
+
+public:
+  bool ok = true;
+
+  Reader(const char *data, size_t size, size_t position)
+      : data(data), size(size), position(position) {}
+
+  template <typename T> std::span<const T> array() {
+    uint64_t count = 0;
+    if (!ok || size - position < sizeof(count)) {
+      ok = false;
+      return {};
+    }
+    std::memcpy(&count, data + position, sizeof(count));
+    position += sizeof(count);
+    if (count > (size - position) / sizeof(T)) {
+      ok = false;
+      return {};
+    }
+    auto result = std::span<const T>(
+        reinterpret_cast<const T *>(data + position), count);
+    position = std::min(size, position + align8(count * sizeof(T)));
+    return result;
+  }
+
+  // 读取定长的标量组
+  template <size_t N> std::array<uint64_t, N> scalars() {
+    std::array<uint64_t, N> result{};
+    auto values = array<uint64_t>();
+    if (values.size() != N) {
+      ok = false;
+      return result;
+    }
+    std::copy(values.begin(), values.end(), result.begin());
+    return result;
+  }
+};
+
+// 行位移表的每一行都落在表内，默认值与显式值都满足 valid
+template <typename Valid>
+bool check_comb(std::span<const int32_t> base,
+                std::span<const int16_t> defaults,
+                std::span<const int16_t> values,
+                std::span<const int16_t> check, size_t rows, size_t columns,
+                Valid valid) {
+  if (base.size() != rows || defaults.size() != rows ||
+      values.size() != check.size()) {
+    return false;
+  }
+  for (auto b : base) {
+    if (b < 0 || static_cast<size_t>(b) + columns > values.size()) {
+      return false;
+    }
+  }
+  return std::all_of(defaults.begin(), defaults.end(), valid) &&
+         std::all_of(values.begin(), values.end(), valid);
+}
+
+bool validate(const ParserCache::Image &image) {
+  size_t name_count =
+      image.name_offsets.empty() ? 0 : image.name_offsets.size() - 1;
+  if (image.name_offsets.empty() ||
+      image.name_offsets.back() != image.names.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < name_count; i++) {
+    if (image.name_offsets[i] > image.name_offsets[i + 1]) {
+      return false;
+    }
+  }
+  auto valid_symbol = [&](const ParserCache::Symbol &symbol) {
+    return symbol.name < name_count &&
+           symbol.type <=
+               static_cast<uint32_t>(SLRSymbolType::SPECIAL_TERMINAL);
+  };
+  if (!std::all_of(image.symbols.begin(), image.symbols.end(), valid_symbol) ||
+      !std::all_of(image.terminals.begin(), image.terminals.end(),
+                   valid_symbol) ||
+      image.terminals.empty() || image.non_terminals.empty() ||
+      image.productions.empty()) {
+    return false;
+  }
+  for (auto name : image.non_terminals) {
+    if (name >= name_count) {
+      return false;
+    }
+  }
+
+  // 右部的终结符都在终结符表中，非终结符都在非终结符表中
+  // 按符号名比较，名字表中重复的名字会登记为同一个符号
+  auto name_of = [&](uint32_t name) {
+    return std::string_view(image.names.data() + image.name_offsets[name],
+                            image.name_offsets[name + 1] -
+                                image.name_offsets[name]);
+  };
+  std::set<std::pair<std::string_view, uint32_t>> terminals;
+  for (const auto &symbol : image.terminals) {
+    terminals.emplace(name_of(symbol.name), symbol.type);
+  }
+  std::set<std::string_view> non_terminals;
+  for (auto name : image.non_terminals) {
+    non_terminals.insert(name_of(name));
+  }
+  for (const auto &symbol : image.symbols) {
+    bool known =
+        is_terminal(static_cast<SLRSymbolType>(symbol.type))
+            ? terminals.contains({name_of(symbol.name), symbol.type})
+            : non_terminals.contains(name_of(symbol.name));
+    if (!known) {
+      return false;
+    }
+  }
+
+  size_t non_terminal_count = image.non_terminals.size();
+  for (const auto &entry : image.productions) {
+    if (entry.non_terminal >= non_terminal_count ||
+        entry.rule >= image.rules.size() ||
+        entry.offset > image.symbols.size() ||
+        entry.length > image.symbols.size() - entry.offset) {
+      return false;
+    }
+  }
+  if (image.productions[0].length != 1) {
+    return false;
+  }
+  for (const auto &rule : image.rules) {
+    if (rule.children_begin > rule.children_end ||
+        rule.children_end > image.rule_children.size() ||
+        rule.action_begin > rule.action_end ||
+        rule.action_end > image.rule_actions.size()) {
+      return false;
+    }
+  }
+  // AST规则选取的子节点都在产生式右部之内
+  for (const auto &entry : image.productions) {
+    const ParserCache::Rule &rule = image.rules[entry.rule];
+    for (size_t i = rule.children_begin; i < rule.children_end; i++) {
+      if (image.rule_children[i] >= entry.length) {
+        return false;
+      }
+    }
+  }
+  if (image.production_begin.size() != non_terminal_count + 1 ||
+      image.production_begin.back() != image.productions.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < non_terminal_count; i++) {
+    if (image.production_begin[i] > image.production_begin[i + 1]) {
+      return false;
+    }
+  }
+
+  // 分析表中的状态、产生式与终结符类都在范围内
+  size_t states = image.state_count;
+  size_t productions = image.productions.size();
+  auto valid_action = [&](int16_t action) {
+    if (action >= 0) {
+      return static_cast<size_t>(action) < states;
+    }
+    return ParseTables::reduced_production(action) < productions;
+  };
+  auto valid_goto = [&](int16_t target) {
+    return target >= 0 && static_cast<size_t>(target) < states;
+  };
+  if (states == 0 ||
+      !check_comb(image.action_base, image.action_defaults,
+                  image.action_values, image.action_check, states,
+                  image.class_count, valid_action) ||
+      !check_comb(image.goto_base, image.goto_defaults, image.goto_values,
+                  image.goto_check, non_terminal_count, states, valid_goto)) {
+    return false;
+  }
+  auto valid_class = [&](uint16_t value) {
+    return value == ParseTables::NO_CLASS || value < image.class_count;
+  };
+  if (image.terminal_class.size() != image.terminals.size() ||
+      image.byte_class.size() != 256 ||
+      !std::all_of(image.terminal_class.begin(), image.terminal_class.end(),
+                   valid_class) ||
+      !std::all_of(image.byte_class.begin(), image.byte_class.end(),
+                   valid_class)) {
+    return false;
+  }
+
+  // 词法自动机的转移与接受信息都在范围内
+  size_t lexer_states = image.lexer_states;
+  size_t lexer_terminals = image.terminals.size() - 1;
+  if (lexer_states == 0 || image.byte_classes.size() != 256 ||
+      image.accepts.size() != lexer_states ||
+      image.transitions.size() / lexer_states != image.lexer_classes ||
+      image.transitions.size() % lexer_states != 0) {
+    return false;
+  }
+  for (auto byte_class : image.byte_classes) {
+    if (byte_class >= image.lexer_classes) {
+      return false;
+    }
+  }
+  for (auto next : image.transitions) {
+    if (next < tokenizer::LexerAutomaton::NO_STATE ||
+        (next >= 0 && static_cast<size_t>(next) >= lexer_states)) {
+      return false;
+    }
+  }
+  auto valid_terminal = [&](int32_t terminal) {
+    return terminal == tokenizer::LexerAutomaton::NO_TERMINAL ||
+           (terminal >= 0 && static_cast<size_t>(terminal) < lexer_terminals);
+  };
+  for (const auto &accept : image.accepts) {
+    if (!valid_terminal(accept.terminal) || !valid_terminal(accept.token)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+ParserCache::ParserCache(ParserCache &&other) noexcept
+    : data(other.data), size(other.size), image(other.image) {
+  other.data = nullptr;
+  other.size = 0;
+  other.image = {};
+}
+
+ParserCache &ParserCache::operator=(ParserCache &&other) noexcept {
+  if (this != &other) {
+    release();
+    data = other.data;
+    size = other.size;
+    image = other.image;
+    other.data = nullptr;
+    other.size = 0;
+    other.image = {};
+  }
+  return *this;
+}
+
+void ParserCache::release() {
+  if (data != nullptr) {
+    munmap(const_cast<char *>(data), size);
+    data = nullptr;
+    size = 0;
+  }
+}
+
+uint64_t ParserCache::key(std::string_view grammar_text,
+                          std::string_view start_symbol, ParserMode mode) {
+  uint64_t hash = grammar::hash_grammar_text(grammar_text);
+  auto mix = [&](uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+      hash ^= (value >> (i * 8)) & 0xff;
+      hash *= 0x100000001b3ULL;
+    }
+  };
+  mix(grammar::hash_grammar_text(start_symbol));
+  mix(static_cast<uint64_t>(mode));
+  mix(PARSER_CACHE_VERSION);
+  mix(tokenizer::LEXER_TABLES_VERSION);
+  // 程序重新编译后分析表的构造方式可能已经改变而版本号没有递增，
+  // 混入本文件的编译时间与可执行文件的大小、修改时间，使其它构建写入的缓存失效
+  mix(grammar::hash_grammar_text(__DATE__ " " __TIME__));
+  struct stat st;
+  if (stat("/proc/self/exe", &st) == 0) {
+    mix(static_cast<uint64_t>(st.st_size));
+    mix(static_cast<uint64_t>(st.st_mtim.tv_sec));
+    mix(static_cast<uint64_t>(st.st_mtim.tv_nsec));
+  }
+  return hash;
+}
+
+std::optional<ParserCache> ParserCache::open(const std::string &filename,
+                                             uint64_t key) {
+  // 缓存不存在是正常情况，不报错
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return std::nullopt;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      static_cast<size_t>(st.st_size) < sizeof(Header)) {
+    close(fd);
+    return std::nullopt;
+  }
+  void *addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ,
+                    MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    return std::nullopt;
+  }
+
+  ParserCache cache;
+  cache.data = static_cast<const char *>(addr);
+  cache.size = static_cast<size_t>(st.st_size);
+
+  Header header;
+  std::memcpy(&header, cache.data, sizeof(header));
+  if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      header.version != PARSER_CACHE_VERSION ||
+      header.byte_order != BYTE_ORDER_MARK || header.key != key) {
+    return std::nullopt;
+  }
+  if (header.checksum != checksum(cache.data, cache.size)) {
+    std::cerr << "分析表缓存 " << filename << " 已损坏，重新构建" << std::endl;
+    return std::nullopt;
+  }
+
+  Reader reader(cache.data, cache.size, sizeof(Header));
+  Image &image = cache.image;
+  image.name_offsets = reader.array<uint32_t>();
+  image.names = reader.array<char>();
+  image.symbols = reader.array<Symbol>();
+  image.productions = reader.array<CompiledGrammar::ProductionEntry>();
+  image.rules = reader.array<Rule>();
+  image.rule_children = reader.array<uint64_t>();
+  image.rule_actions = reader.array<char>();
+  image.terminals = reader.array<Symbol>();
+  image.non_terminals = reader.array<uint32_t>();
+  image.production_begin = reader.array<uint32_t>();
+  auto [state_count, class_count] = reader.scalars<2>();
+  image.state_count = state_count;
+  image.class_count = class_count;
+  image.action_base = reader.array<int32_t>();
+  image.action_defaults = reader.array<int16_t>();
+  image.action_values = reader.array<int16_t>();
+  image.action_check = reader.array<int16_t>();
+  image.goto_base = reader.array<int32_t>();
+  image.goto_defaults = reader.array<int16_t>();
+  image.goto_values = reader.array<int16_t>();
+  image.goto_check = reader.array<int16_t>();
+  image.terminal_class = reader.array<uint16_t>();
+  image.byte_class = reader.array<uint16_t>();
+  auto [lexer_states, lexer_classes] = reader.scalars<2>();
+  image.lexer_states = lexer_states;
+  image.lexer_classes = lexer_classes;
+  image.byte_classes = reader.array<uint8_t>();
+  image.transitions = reader.array<int32_t>();
+  image.accepts = reader.array<tokenizer::LexerAutomaton::Accept>();
+
+  if (!reader.ok || !validate(image)) {
+    std::cerr << "分析表缓存 " << filename << " 已损坏，重新构建" << std::endl;
+    return std::nullopt;
+  }
+  return cache;
+}
+
+bool ParserCache::write(const std::string &filename, uint64_t key,
+                        const SLR1Parser &parser,
+                        const tokenizer::Lexer &lexer) {
+  const CompiledGrammar &flat = *parser.compiled;
+  const ParseTables &tables = parser.tables;
+  const tokenizer::LexerAutomaton &automaton = lexer.automaton;
+
+  // 用到的符号名按首次出现的顺序编号
+  std::vector<uint32_t> name_offsets{0};
+  std::string names;
+  std::unordered_map<grammar::SymbolId, uint32_t> name_index;
+  auto name_of = [&](grammar::SymbolId id) {
+    auto [it, created] =
+        name_index.emplace(id, static_cast<uint32_t>(name_index.size()));
+    if (created) {
+      names += grammar::symbol_name(id);
+      name_offsets.push_back(static_cast<uint32_t>(names.size()));
+    }
+    return it->second;
+  };
+  auto to_symbols = [&](const std::vector<SLRSymbol> &symbols) {
+    std::vector<Symbol> result;
+    result.reserve(symbols.size());
+    for (const auto &symbol : symbols) {
+      result.push_back(
+          Symbol{name_of(symbol.id), static_cast<uint32_t>(symbol.type)});
+    }
+    return result;
+  };
+  auto symbols = to_symbols(flat.symbols);
+  auto terminals = to_symbols(flat.terminals);
+  std::vector<uint32_t> non_terminals;
+  for (auto id : flat.non_terminals) {
+    non_terminals.push_back(name_of(id));
+  }
+
+  std::vector<Rule> rules;
+  std::vector<uint64_t> rule_children;
+  std::string rule_actions;
+  for (const auto &rule : flat.rules) {
+    Rule entry;
+    entry.children_begin = static_cast<uint32_t>(rule_children.size());
+    rule_children.insert(rule_children.end(), rule.ast_children.begin(),
+                         rule.ast_children.end());
+    entry.children_end = static_cast<uint32_t>(rule_children.size());
+    entry.action_begin = static_cast<uint32_t>(rule_actions.size());
+    rule_actions += rule.sematic_actions;
+    entry.action_end = static_cast<uint32_t>(rule_actions.size());
+    entry.do_flatten = rule.do_flatten;
+    entry.use_all_children = rule.use_all_children;
+    rules.push_back(entry);
+  }
+
+  Header header;
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = PARSER_CACHE_VERSION;
+  header.byte_order = BYTE_ORDER_MARK;
+  header.key = key;
+  header.checksum = 0;
+
+  Writer writer;
+  writer.buffer.append(reinterpret_cast<const char *>(&header),
+                       sizeof(header));
+  writer.array(name_offsets);
+  writer.array(std::span<const char>(names));
+  writer.array(symbols);
+  writer.array(flat.productions);
+  writer.array(rules);
+  writer.array(rule_children);
+  writer.array(std::span<const char>(rule_actions));
+  writer.array(terminals);
+  writer.array(non_terminals);
+  writer.array(flat.production_begin);
+  writer.scalars({parser.state_count, tables.class_count});
+  writer.array(tables.action.base);
+  writer.array(tables.action.defaults);
+  writer.array(tables.action.values);
+  writer.array(tables.action.check);
+  writer.array(tables.gotos.base);
+  writer.array(tables.gotos.defaults);
+  writer.array(tables.gotos.values);
+  writer.array(tables.gotos.check);
+  writer.array(tables.terminal_class);
+  writer.array(tables.byte_class);
+  writer.scalars({automaton.states, automaton.class_count});
+  writer.array(std::span<const uint8_t>(automaton.byte_classes, 256));
+  writer.array(std::span<const int32_t>(
+      automaton.transitions, automaton.states * automaton.class_count));
+  writer.array(std::span<const tokenizer::LexerAutomaton::Accept>(
+      automaton.accepts, automaton.states));
+  uint64_t sum = checksum(writer.buffer.data(), writer.buffer.size());
+  std::memcpy(writer.buffer.data() + offsetof(Header, checksum), &sum,
+              sizeof(sum));
+
+  std::string temporary = filename + ".tmp";
+  {
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    out.write(writer.buffer.data(),
+              static_cast<std::streamsize>(writer.buffer.size()));
+    if (!out) {
+      std::cerr << "Failed to write parser cache: " << temporary << std::endl;
+      std::remove(temporary.c_str());
+      return false;
+    }
+  }
+  if (std::rename(temporary.c_str(), filename.c_str()) != 0) {
+    std::cerr << "Failed to write parser cache: " << filename << std::endl;
+    std::remove(temporary.c_str());
+    return false;
+  }
+  return true;
+}
+
+SLR1Parser ParserCache::parser() const {
+  // 缓存中的符号名重新登记到全局符号表
+  std::vector<grammar::SymbolId> ids;
+  ids.reserve(image.name_offsets.size() - 1);
+  for (size_t i = 0; i + 1 < image.name_offsets.size(); i++) {
+    ids.push_back(grammar::intern_symbol(std::string_view(
+        image.names.data() + image.name_offsets[i],
+        image.name_offsets[i + 1] - image.name_offsets[i])));
+  }
+  auto to_symbol = [&](const Symbol &symbol) {
+    return SLRSymbol(ids[symbol.name], static_cast<SLRSymbolType>(symbol.type));
+  };
+
+  CompiledGrammar flat;
+  for (const auto &symbol : image.symbols) {
+    flat.symbols.push_back(to_symbol(symbol));
+  }
+  flat.productions.assign(image.productions.begin(), image.productions.end());
+  for (const auto &rule : image.rules) {
+    flat.rules.push_back(CompiledGrammar::RuleEntry{
+        std::vector<size_t>(image.rule_children.begin() + rule.children_begin,
+                            image.rule_children.begin() + rule.children_end),
+        rule.do_flatten != 0, rule.use_all_children != 0,
+        std::string(image.rule_actions.data() + rule.action_begin,
+                    rule.action_end - rule.action_begin)});
+  }
+  for (size_t i = 0; i < image.terminals.size(); i++) {
+    flat.terminals.push_back(to_symbol(image.terminals[i]));
+    flat.terminal_index[flat.terminals.back()] = static_cast<uint32_t>(i);
+  }
+  for (size_t i = 0; i < image.non_terminals.size(); i++) {
+    flat.non_terminals.push_back(ids[image.non_terminals[i]]);
+    flat.non_terminal_index[flat.non_terminals.back()] =
+        static_cast<uint32_t>(i);
+  }
+  flat.production_begin.assign(image.production_begin.begin(),
+                               image.production_begin.end());
+  flat.index_symbols();
+
+  SLR1Parser parser{grammar::Grammar(std::vector<grammar::GrammarRule>{})};
+  parser.augmented_start_symbol = flat.non_terminals[0];
+  parser.start_symbol = flat.rhs(0)[0].id;
+  parser.compiled = std::make_shared<const CompiledGrammar>(std::move(flat));
+  for (size_t i = 0; i < parser.compiled->productions.size(); i++) {
+    parser.productions.push_back(parser.compiled->production(i));
+  }
+  parser.terminal_symbols.assign(parser.compiled->terminals.begin(),
+                                 parser.compiled->terminals.end() - 1);
+  parser.state_count = image.state_count;
+
+  auto comb = [](std::span<const int32_t> base,
+                 std::span<const int16_t> defaults,
+                 std::span<const int16_t> values,
+                 std::span<const int16_t> check) {
+    CombTable table;
+    table.base.assign(base.begin(), base.end());
+    table.defaults.assign(defaults.begin(), defaults.end());
+    table.values.assign(values.begin(), values.end());
+    table.check.assign(check.begin(), check.end());
+    return table;
+  };
+  ParseTables &tables = parser.tables;
+  tables.action = comb(image.action_base, image.action_defaults,
+                       image.action_values, image.action_check);
+  tables.gotos = comb(image.goto_base, image.goto_defaults, image.goto_values,
+                      image.goto_check);
+  tables.terminal_class.assign(image.terminal_class.begin(),
+                               image.terminal_class.end());
+  tables.byte_class.assign(image.byte_class.begin(), image.byte_class.end());
+  tables.class_count = image.class_count;
+  return parser;
+}
+
+tokenizer::Lexer ParserCache::lexer() const {
+  // 词法终结符即分析表的终结符去掉结束符号，编号一致
+  std::vector<grammar::Terminal> terminals;
+  for (size_t i = 0; i + 1 < image.terminals.size(); i++) {
+    const auto &symbol = image.terminals[i];
+    terminals.emplace_back(
+        std::string_view(image.names.data() + image.name_offsets[symbol.name],
+                         image.name_offsets[symbol.name + 1] -
+                             image.name_offsets[symbol.name]),
+        static_cast<SLRSymbolType>(symbol.type) ==
+            SLRSymbolType::SPECIAL_TERMINAL);
+  }
+  return tokenizer::Lexer(
+      terminals, tokenizer::LexerAutomaton(
+                     image.lexer_states, image.lexer_classes,
+                     image.byte_classes.data(), image.transitions.data(),
+                     image.accepts.data()));
+}
+
+} // namespace slr
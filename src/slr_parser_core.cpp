@@ -3,32 +3,48 @@
 
 namespace slr {
 
-// 构建解析表，指定开始符号
-bool SLR1Parser::build_parse_table(const std::string &start_symbol) {
-  this->start_symbol = start_symbol;
-  this->augmented_start_symbol = start_symbol + "'";
+// 构建解析表，指定开始符号与构造方法
+bool SLR1Parser::build_parse_table(const std::string &start_symbol,
+                                   ParserMode mode, size_t thread_count) {
+  this->mode = mode;
+  this->start_symbol = grammar::intern_symbol(start_symbol);
+
+  // 终结符编号与 Grammar::extract_terminals 的下标一致
+  terminal_symbols.clear();
+  for (const auto &terminal : grammar.extract_terminals()) {
+    terminal_symbols.push_back(SLRSymbol(terminal));
+  }
 
   // 增广文法
-  initialize_augment_grammar();
+  if (!initialize_augment_grammar()) {
+    return false;
+  }
 
-  // 计算FIRST和FOLLOW集合
-  compute_first_sets();
-  compute_follow_sets();
+  // SLR(1) 的向前看取FOLLOW集合，LALR(1) 在项目集族上计算
+  first_sets.clear();
+  follow_sets.clear();
+  if (mode == ParserMode::SLR1) {
+    compute_first_sets();
+    compute_follow_sets();
+  }
 
   // 构建项目集族和分析表
-  build_item_sets();
+  build_item_sets(thread_count);
+  if (mode == ParserMode::LALR1) {
+    compute_lalr_lookaheads();
+  }
   build_tables();
 
-  return true;
+  return compress_tables();
 }
 
 // 执行移进操作
-void SLR1Parser::perform_shift(int next_state, const SLRSymbol &symbol,
+void SLR1Parser::perform_shift(int next_state, CSTNode leaf,
                                std::stack<int> &state_stack,
                                std::stack<CSTNode> &symbol_stack,
                                size_t &input_pos) {
   state_stack.push(next_state);
-  symbol_stack.push(CSTNode(symbol));
+  symbol_stack.push(std::move(leaf));
   input_pos++;
 }
 
@@ -60,16 +76,9 @@ bool SLR1Parser::perform_reduce(int prod_index, std::stack<int> &state_stack,
   // 获取当前状态
   int current_state = state_stack.top();
 
-  // 查找GOTO表中的下一个状态
-  SLRSymbol non_terminal(production.left, SLRSymbolType::NON_TERMINAL);
-
-  if (goto_table.find(current_state) == goto_table.end() ||
-      goto_table.at(current_state).find(non_terminal) ==
-          goto_table.at(current_state).end()) {
-    return false;
-  }
-
-  int next_state = goto_table.at(current_state).at(non_terminal);
+  // 查找GOTO表中的下一个状态，归约之后的GOTO总是存在
+  int next_state = tables.gotos.at(
+      compiled->productions[prod_index].non_terminal, current_state);
 
   // 压入新状态和符号
   state_stack.push(next_state);
@@ -92,12 +101,20 @@ bool SLR1Parser::perform_accept(std::stack<CSTNode> &symbol_stack,
 // 处理语法错误
 bool SLR1Parser::handle_error(int state, const SLRSymbol &symbol,
                               size_t input_pos) {
-  std::cerr << "Syntax error at position " << input_pos
-            << ": unexpected symbol " << symbol.to_string() << " in state "
-            << state << std::endl;
+  return handle_error(state, symbol.to_string(),
+                      "position " + std::to_string(input_pos));
+}
+
+bool SLR1Parser::handle_error(int state, const std::string &symbol,
+                              const std::string &position) {
+  std::cerr << "Syntax error at " << position << ": unexpected symbol "
+            << symbol << " in state " << state << std::endl;
   std::cerr << "Expected one of: ";
-  for (const auto &expected : action_table[state]) {
-    std::cerr << expected.first.to_string() << " ";
+  for (size_t terminal = 0; terminal < compiled->terminals.size(); terminal++) {
+    if (tables.action_at(state, tables.class_of(terminal)) !=
+        ParseTables::ERROR) {
+      std::cerr << compiled->terminals[terminal].to_string() << " ";
+    }
   }
   return false;
 }
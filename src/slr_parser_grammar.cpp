@@ -0,0 +1,128 @@
+#include "../include/slr_parser.hpp"
+
+namespace slr {
+
+// 按语法文件中的顺序展开所有规则，0 号产生式为 S' -> 开始符号
+CompiledGrammar
+CompiledGrammar::compile(const grammar::Grammar &grammar,
+                         grammar::SymbolId start_symbol,
+                         grammar::SymbolId augmented_start_symbol) {
+  CompiledGrammar result;
+
+  auto add_non_terminal = [&](grammar::SymbolId name) {
+    result.non_terminal_index[name] =
+        static_cast<uint32_t>(result.non_terminals.size());
+    result.non_terminals.push_back(name);
+    result.production_begin.push_back(
+        static_cast<uint32_t>(result.productions.size()));
+  };
+
+  auto add_production = [&](uint32_t rule, const auto &symbols) {
+    ProductionEntry entry;
+    entry.non_terminal = static_cast<uint32_t>(result.non_terminals.size() - 1);
+    entry.offset = static_cast<uint32_t>(result.symbols.size());
+    entry.length = static_cast<uint32_t>(symbols.size());
+    entry.rule = rule;
+    for (const auto &sym : symbols) {
+      result.symbols.push_back(SLRSymbol(sym));
+    }
+    result.productions.push_back(entry);
+  };
+
+  add_non_terminal(augmented_start_symbol);
+  result.rules.push_back(RuleEntry{{0}, false, true, ""});
+  add_production(0, std::vector<SLRSymbol>{
+                        SLRSymbol(start_symbol, SLRSymbolType::NON_TERMINAL)});
+
+  for (const auto &name : grammar.order) {
+    add_non_terminal(name);
+    for (const auto &rule : grammar.rule_map.at(name)) {
+      auto rule_index = static_cast<uint32_t>(result.rules.size());
+      result.rules.push_back(RuleEntry{rule.ast_rule.children,
+                                       rule.ast_rule.do_flatten,
+                                       rule.ast_rule.use_all_children,
+                                       rule.sematic_actions});
+      for (const auto &prod : rule.right.production) {
+        add_production(rule_index, prod);
+      }
+    }
+  }
+  result.production_begin.push_back(
+      static_cast<uint32_t>(result.productions.size()));
+
+  // 终结符沿用词法分析器的编号，结束符号排在最后
+  for (const auto &terminal : grammar.extract_terminals()) {
+    result.terminals.push_back(SLRSymbol(terminal));
+  }
+  result.terminals.push_back(SLRSymbol::get_eos_symbol());
+  for (size_t i = 0; i < result.terminals.size(); i++) {
+    result.terminal_index[result.terminals[i]] = static_cast<uint32_t>(i);
+  }
+  result.index_symbols();
+
+  return result;
+}
+
+void CompiledGrammar::index_symbols() {
+  symbol_index.resize(symbols.size());
+  for (size_t i = 0; i < symbols.size(); i++) {
+    const auto &symbol = symbols[i];
+    if (is_terminal(symbol.type)) {
+      symbol_index[i] = terminal_index.at(symbol);
+    } else {
+      symbol_index[i] = find_non_terminal(symbol.id).value_or(UINT32_MAX);
+    }
+  }
+}
+
+Production CompiledGrammar::production(size_t production) const {
+  const auto &rule = rules[productions[production].rule];
+  return Production(left(production), rhs(production), rule.ast_children,
+                    rule.do_flatten, rule.use_all_children,
+                    rule.sematic_actions);
+}
+
+CompiledGrammar CompiledGrammar::prune(const std::vector<bool> &keep) const {
+  CompiledGrammar result;
+  result.rules = rules;
+  result.terminals = terminals;
+  result.terminal_index = terminal_index;
+
+  auto kept = [&](const SLRSymbol &symbol) {
+    if (is_terminal(symbol.type)) {
+      return true;
+    }
+    auto index = find_non_terminal(symbol.id);
+    return index && keep[*index];
+  };
+
+  for (size_t nt = 0; nt < non_terminals.size(); nt++) {
+    if (!keep[nt]) {
+      continue;
+    }
+    auto index = static_cast<uint32_t>(result.non_terminals.size());
+    result.non_terminal_index[non_terminals[nt]] = index;
+    result.non_terminals.push_back(non_terminals[nt]);
+    result.production_begin.push_back(
+        static_cast<uint32_t>(result.productions.size()));
+    for (uint32_t p = production_begin[nt]; p < production_begin[nt + 1];
+         p++) {
+      auto right = rhs(p);
+      if (!std::all_of(right.begin(), right.end(), kept)) {
+        continue;
+      }
+      ProductionEntry entry = productions[p];
+      entry.non_terminal = index;
+      entry.offset = static_cast<uint32_t>(result.symbols.size());
+      result.symbols.insert(result.symbols.end(), right.begin(), right.end());
+      result.productions.push_back(entry);
+    }
+  }
+  result.production_begin.push_back(
+      static_cast<uint32_t>(result.productions.size()));
+  result.index_symbols();
+
+  return result;
+}
+
+} // namespace slr
@@ -0,0 +1,123 @@
+#include "../include/slr_parser.hpp"
+
+namespace slr {
+
+namespace {
+
+// 在按 (编号, 类型) 排序的转移中查找符号，返回其位置
+std::optional<size_t>
+find_transition(const std::vector<std::pair<SLRSymbol, int>> &edges,
+                const SLRSymbol &symbol) {
+  auto it = std::lower_bound(
+      edges.begin(), edges.end(), symbol,
+      [](const std::pair<SLRSymbol, int> &edge, const SLRSymbol &target) {
+        if (edge.first.id != target.id) {
+          return edge.first.id < target.id;
+        }
+        return edge.first.type < target.type;
+      });
+  if (it == edges.end() || !(it->first == symbol)) {
+    return std::nullopt;
+  }
+  return static_cast<size_t>(it - edges.begin());
+}
+
+} // namespace
+
+// DeRemer–Pennello，对每个非终结符转移 (p, A)：
+//   DR(p, A) = { t | goto(p, A) 上有 t 的移进 }
+//   (p, A) reads (r, C)：r = goto(p, A)，r 上有 C 的转移且 C 可空
+//   (p, A) includes (p', B)：B -> β A γ，γ 可空，p' 经 β 到达 p
+//   (q, A -> ω) lookback (p, A)：p 经 ω 到达 q
+// Read = Digraph(reads, DR)，Follow = Digraph(includes, Read)
+// LA(q, A -> ω) = ⋃{ Follow(p, A) | (q, A -> ω) lookback (p, A) }
+void SLR1Parser::compute_lalr_lookaheads() {
+  const auto &flat = *compiled;
+  size_t terminal_count = flat.terminals.size();
+
+  // 给非终结符转移编号，goto_index[p][k] 为 transitions[p][k] 的编号
+  std::vector<std::vector<uint32_t>> goto_index(state_count);
+  std::vector<std::pair<uint32_t, uint32_t>> gotos; // (状态, 转移位置)
+  for (uint32_t p = 0; p < state_count; p++) {
+    goto_index[p].assign(transitions[p].size(), UINT32_MAX);
+    for (uint32_t k = 0; k < transitions[p].size(); k++) {
+      if (is_non_terminal(transitions[p][k].first.type)) {
+        goto_index[p][k] = static_cast<uint32_t>(gotos.size());
+        gotos.emplace_back(p, k);
+      }
+    }
+  }
+
+  std::vector<Bitset> sets(gotos.size(), Bitset(terminal_count));
+  std::vector<std::vector<uint32_t>> reads(gotos.size());
+  for (uint32_t g = 0; g < gotos.size(); g++) {
+    auto [p, k] = gotos[g];
+    auto r = static_cast<uint32_t>(transitions[p][k].second);
+    for (uint32_t j = 0; j < transitions[r].size(); j++) {
+      const auto &symbol = transitions[r][j].first;
+      if (is_terminal(symbol.type)) {
+        sets[g].set(flat.terminal_index.at(symbol));
+      } else if (analysis.nullable[*flat.find_non_terminal(symbol.id)]) {
+        reads[g].push_back(goto_index[r][j]);
+      }
+    }
+  }
+  // 增广产生式 S' -> 开始符号 之后是结束符号
+  if (auto k = find_transition(transitions[0], flat.rhs(0)[0])) {
+    sets[goto_index[0][*k]].set(flat.eos());
+  }
+  digraph(reads, sets);
+
+  lookaheads.assign(state_count, {});
+  for (size_t q = 0; q < state_count; q++) {
+    lookaheads[q].assign(reductions[q].size(), Bitset(terminal_count));
+  }
+
+  // 从 p' 出发沿 B 的每个产生式右部前进
+  // 途经的状态给出 includes，终点给出 lookback
+  std::vector<std::vector<uint32_t>> includes(gotos.size());
+  std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> lookback;
+  std::vector<std::pair<uint32_t, uint32_t>> path; // (状态, 转移位置)
+  for (uint32_t g = 0; g < gotos.size(); g++) {
+    auto [origin, position] = gotos[g];
+    uint32_t b =
+        *flat.find_non_terminal(transitions[origin][position].first.id);
+    for (uint32_t production = flat.production_begin[b];
+         production < flat.production_begin[b + 1]; production++) {
+      auto right = flat.rhs(production);
+      uint32_t state = origin;
+      path.clear();
+      for (const auto &symbol : right) {
+        // B 的初始项目都在 p' 的闭包中，沿右部的转移总是存在
+        size_t k = *find_transition(transitions[state], symbol);
+        path.emplace_back(state, static_cast<uint32_t>(k));
+        state = static_cast<uint32_t>(transitions[state][k].second);
+      }
+
+      for (size_t i = right.size(); i-- > 0;) {
+        if (is_terminal(right[i].type)) {
+          break;
+        }
+        auto [from, k] = path[i];
+        includes[goto_index[from][k]].push_back(g);
+        size_t index = flat.productions[production].offset + i;
+        if (!analysis.nullable[flat.symbol_index[index]]) {
+          break;
+        }
+      }
+
+      const auto &complete = reductions[state];
+      auto slot =
+          std::lower_bound(complete.begin(), complete.end(), production) -
+          complete.begin();
+      lookback.emplace_back(state, static_cast<uint32_t>(slot), g);
+    }
+  }
+  digraph(includes, sets);
+
+  for (auto [state, slot, g] : lookback) {
+    lookaheads[state][slot].merge(sets[g]);
+  }
+}
+
+} // namespace slr
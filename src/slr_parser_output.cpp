@@ -40,10 +40,10 @@ void SLR1Parser::print_parse_table() const {
   // 打印表头
   std::cout << std::setw(5) << "状态";
   for (const auto &terminal : terminals) {
-    std::cout << std::setw(10) << terminal.value;
+    std::cout << std::setw(10) << terminal.value();
   }
   for (const auto &non_terminal : non_terminals) {
-    std::cout << std::setw(10) << non_terminal.value;
+    std::cout << std::setw(10) << non_terminal.value();
   }
   std::cout << std::endl;
 
@@ -53,7 +53,7 @@ void SLR1Parser::print_parse_table() const {
             << std::endl;
 
   // 打印表内容
-  for (size_t i = 0; i < item_sets.size(); ++i) {
+  for (size_t i = 0; i < state_count; ++i) {
     std::cout << std::setw(5) << i;
 
     // 打印ACTION部分
@@ -83,9 +83,10 @@ void SLR1Parser::print_parse_table() const {
   // 打印产生式
   std::cout << "\n===== 产生式 =====" << std::endl;
   for (size_t i = 0; i < productions.size(); ++i) {
-    std::cout << i << ": " << productions[i].left << " -> ";
+    std::cout << i << ": " << grammar::symbol_name(productions[i].left)
+              << " -> ";
     for (const auto &symbol : productions[i].right) {
-      std::cout << symbol.value << " ";
+      std::cout << symbol.value() << " ";
     }
     std::cout << std::endl;
   }
@@ -123,12 +124,12 @@ std::string SLR1Parser::to_json() const {
   for (size_t i = 0; i < productions.size(); ++i) {
     nlohmann::json prod;
     prod["index"] = i;
-    prod["left"] = productions[i].left;
+    prod["left"] = grammar::symbol_name(productions[i].left);
 
     nlohmann::json right = nlohmann::json::array();
     for (const auto &symbol : productions[i].right) {
       nlohmann::json sym;
-      sym["value"] = symbol.value;
+      sym["value"] = symbol.value();
       sym["type"] = is_terminal(symbol.type) ? "terminal" : "non-terminal";
       right.push_back(sym);
     }
@@ -137,21 +138,25 @@ std::string SLR1Parser::to_json() const {
   }
   result["productions"] = productions_json;
 
-  // 导出项目集族
+  // 导出项目集族，闭包在导出时由核心项目计算
   nlohmann::json item_sets_json = nlohmann::json::array();
-  for (size_t i = 0; i < item_sets.size(); ++i) {
+  std::vector<LR0Item> closure_items;
+  Bitset scratch(compiled ? compiled->productions.size() : 0);
+  for (size_t i = 0; i < kernels.size(); ++i) {
     nlohmann::json item_set;
     item_set["state"] = i;
 
     nlohmann::json items = nlohmann::json::array();
-    for (const auto &item : item_sets[i]) {
+    closure(kernels[i], closure_items, scratch);
+    for (const auto &item : closure_items) {
       nlohmann::json item_json;
-      item_json["non_terminal"] = item.non_terminal;
+      item_json["non_terminal"] =
+          grammar::symbol_name(compiled->left(item.production));
 
       nlohmann::json production = nlohmann::json::array();
-      for (const auto &symbol : item.production) {
+      for (const auto &symbol : compiled->rhs(item.production)) {
         nlohmann::json sym;
-        sym["value"] = symbol.value;
+        sym["value"] = symbol.value();
         sym["type"] = is_terminal(symbol.type) ? "terminal" : "non-terminal";
         production.push_back(sym);
       }
@@ -166,7 +171,7 @@ std::string SLR1Parser::to_json() const {
 
   // 导出ACTION表
   nlohmann::json action_table_json = nlohmann::json::array();
-  for (size_t i = 0; i < item_sets.size(); ++i) {
+  for (size_t i = 0; i < state_count; ++i) {
     nlohmann::json state_actions;
     state_actions["state"] = i;
 
@@ -179,7 +184,7 @@ std::string SLR1Parser::to_json() const {
         action_json["type"] = static_cast<int>(action.type);
         action_json["value"] = action.value;
         action_json["display"] = action.to_string();
-        actions[terminal.value] = action_json;
+        actions[terminal.value()] = action_json;
       }
     }
     state_actions["actions"] = actions;
@@ -189,7 +194,7 @@ std::string SLR1Parser::to_json() const {
 
   // 导出GOTO表
   nlohmann::json goto_table_json = nlohmann::json::array();
-  for (size_t i = 0; i < item_sets.size(); ++i) {
+  for (size_t i = 0; i < state_count; ++i) {
     nlohmann::json state_gotos;
     state_gotos["state"] = i;
 
@@ -197,7 +202,7 @@ std::string SLR1Parser::to_json() const {
     for (const auto &non_terminal : non_terminals) {
       if (goto_table.find(i) != goto_table.end() &&
           goto_table.at(i).find(non_terminal) != goto_table.at(i).end()) {
-        gotos[non_terminal.value] = goto_table.at(i).at(non_terminal);
+        gotos[non_terminal.value()] = goto_table.at(i).at(non_terminal);
       }
     }
     state_gotos["gotos"] = gotos;
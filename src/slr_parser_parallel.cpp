@@ -0,0 +1,162 @@
+#include "../include/slr_parser.hpp"
+#include <array>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace slr {
+
+namespace {
+
+constexpr size_t SHARD_COUNT = 64;
+
+// 构建中的状态：核心创建后只读，后继与归约只由展开它的线程写入
+struct PendingState {
+  std::vector<LR0Item> kernel;
+  std::vector<std::pair<SLRSymbol, PendingState *>> targets;
+  std::vector<uint32_t> complete;
+  int number = -1; // 重排后的状态编号
+};
+
+// 按核心的散列值分片的并发表，每片一把锁
+// 状态存放在分片的 deque 中，在尾部追加不会使已有状态的地址失效
+class KernelMap {
+private:
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_multimap<size_t, PendingState *> index;
+    std::deque<PendingState> states;
+  };
+  std::array<Shard, SHARD_COUNT> shards;
+
+public:
+  // 返回核心对应的状态，以及它是否是新建的
+  std::pair<PendingState *, bool> intern(std::vector<LR0Item> kernel) {
+    size_t h = hash_kernel(kernel);
+    Shard &shard = shards[h % SHARD_COUNT];
+    std::lock_guard lock(shard.mutex);
+    auto [begin, end] = shard.index.equal_range(h);
+    for (auto it = begin; it != end; ++it) {
+      if (it->second->kernel == kernel) {
+        return {it->second, false};
+      }
+    }
+    PendingState &state = shard.states.emplace_back();
+    state.kernel = std::move(kernel);
+    shard.index.emplace(h, &state);
+    return {&state, true};
+  }
+};
+
+// 工作窃取队列：所有者从尾部取出，其他线程从头部窃取
+class WorkQueue {
+private:
+  std::mutex mutex;
+  std::deque<PendingState *> states;
+
+public:
+  void push(PendingState *state) {
+    std::lock_guard lock(mutex);
+    states.push_back(state);
+  }
+
+  PendingState *pop() {
+    std::lock_guard lock(mutex);
+    if (states.empty()) {
+      return nullptr;
+    }
+    PendingState *state = states.back();
+    states.pop_back();
+    return state;
+  }
+
+  PendingState *steal() {
+    std::lock_guard lock(mutex);
+    if (states.empty()) {
+      return nullptr;
+    }
+    PendingState *state = states.front();
+    states.pop_front();
+    return state;
+  }
+};
+
+} // namespace
+
+void SLR1Parser::build_item_sets_parallel(size_t thread_count) {
+  const auto &flat = *compiled;
+  KernelMap kernel_map;
+  std::vector<WorkQueue> queues(thread_count);
+
+  // 已创建但尚未展开完的状态数，归零时全部状态都已展开
+  std::atomic<size_t> pending{1};
+  PendingState *initial = kernel_map.intern({LR0Item{0, 0}}).first;
+  queues[0].push(initial);
+
+  auto work = [&](size_t self) {
+    StateScratch scratch(flat.productions.size());
+    std::vector<Successor> successors;
+    while (pending.load(std::memory_order_acquire) != 0) {
+      PendingState *state = queues[self].pop();
+      for (size_t k = 1; state == nullptr && k < thread_count; k++) {
+        state = queues[(self + k) % thread_count].steal();
+      }
+      if (state == nullptr) {
+        std::this_thread::yield();
+        continue;
+      }
+
+      expand_state(state->kernel, scratch, successors, state->complete);
+      for (auto &[symbol, kernel] : successors) {
+        auto [target, created] = kernel_map.intern(std::move(kernel));
+        if (created) {
+          pending.fetch_add(1, std::memory_order_relaxed);
+          queues[self].push(target);
+        }
+        state->targets.emplace_back(symbol, target);
+      }
+      pending.fetch_sub(1, std::memory_order_release);
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < thread_count; i++) {
+    workers.emplace_back(work, i);
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+
+  // 与顺序构建相同的编号：按编号依次处理状态，转移目标首次出现时编号
+  std::vector<PendingState *> order{initial};
+  initial->number = 0;
+  for (size_t i = 0; i < order.size(); i++) {
+    for (const auto &[symbol, target] : order[i]->targets) {
+      if (target->number < 0) {
+        target->number = static_cast<int>(order.size());
+        order.push_back(target);
+      }
+    }
+  }
+
+  kernels.clear();
+  transitions.clear();
+  reductions.clear();
+  kernels.reserve(order.size());
+  transitions.reserve(order.size());
+  reductions.reserve(order.size());
+  for (PendingState *state : order) {
+    std::vector<std::pair<SLRSymbol, int>> targets;
+    targets.reserve(state->targets.size());
+    for (const auto &[symbol, target] : state->targets) {
+      targets.emplace_back(symbol, target->number);
+    }
+    kernels.push_back(std::move(state->kernel));
+    transitions.push_back(std::move(targets));
+    reductions.push_back(std::move(state->complete));
+  }
+  state_count = kernels.size();
+}
+
+} // namespace slr
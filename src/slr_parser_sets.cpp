@@ -0,0 +1,157 @@
+#include "../include/slr_parser.hpp"
+
+namespace slr {
+
+// 迭代实现的 Digraph，避免深递归
+// depth 为结点入栈时的栈深度，随后取可到达的最浅深度；完成的分量记为无穷大
+void digraph(const std::vector<std::vector<uint32_t>> &relation,
+             std::vector<Bitset> &sets) {
+  const uint32_t infinity = UINT32_MAX;
+  struct Frame {
+    uint32_t node;
+    uint32_t entry_depth;
+    size_t edge; // 下一条待访问边的位置
+  };
+  size_t n = relation.size();
+  std::vector<uint32_t> depth(n, 0);
+  std::vector<uint32_t> stack;
+  std::vector<Frame> frames;
+
+  auto enter = [&](uint32_t node) {
+    stack.push_back(node);
+    depth[node] = static_cast<uint32_t>(stack.size());
+    frames.push_back(Frame{node, depth[node], 0});
+  };
+
+  for (uint32_t root = 0; root < n; root++) {
+    if (depth[root] != 0) {
+      continue;
+    }
+    enter(root);
+
+    while (!frames.empty()) {
+      Frame &frame = frames.back();
+      uint32_t x = frame.node;
+      if (frame.edge < relation[x].size()) {
+        uint32_t y = relation[x][frame.edge++];
+        if (depth[y] == 0) {
+          enter(y);
+        } else {
+          depth[x] = std::min(depth[x], depth[y]);
+          if (y != x) {
+            sets[x].merge(sets[y]);
+          }
+        }
+        continue;
+      }
+
+      uint32_t entry_depth = frame.entry_depth;
+      frames.pop_back();
+      if (depth[x] == entry_depth) {
+        // x 是分量的根，分量中的结点共享 x 的集合
+        while (true) {
+          uint32_t top = stack.back();
+          stack.pop_back();
+          depth[top] = infinity;
+          if (top == x) {
+            break;
+          }
+          sets[top] = sets[x];
+        }
+      }
+      // 返回调用者：N(parent) = min(N(parent), N(x))，F(parent) ∪= F(x)
+      if (!frames.empty()) {
+        uint32_t parent = frames.back().node;
+        depth[parent] = std::min(depth[parent], depth[x]);
+        sets[parent].merge(sets[x]);
+      }
+    }
+  }
+}
+
+// FIRST(A) = { a | A -> α a β, α 可空 } ∪ ⋃{ FIRST(B) | A -> α B β, α 可空 }
+void SLR1Parser::compute_first_sets() {
+  const auto &flat = *compiled;
+  size_t count = flat.non_terminals.size();
+  first_sets.assign(count, Bitset(flat.terminals.size()));
+  std::vector<std::vector<uint32_t>> relation(count);
+
+  for (const auto &production : flat.productions) {
+    uint32_t left = production.non_terminal;
+    for (uint32_t k = production.offset;
+         k < production.offset + production.length; k++) {
+      uint32_t index = flat.symbol_index[k];
+      if (is_terminal(flat.symbols[k].type)) {
+        first_sets[left].set(index);
+        break;
+      }
+      relation[left].push_back(index);
+      if (!analysis.nullable[index]) {
+        break;
+      }
+    }
+  }
+
+  digraph(relation, first_sets);
+}
+
+// FOLLOW(B) ⊇ FIRST(β)，A -> α B β；β 可空时 FOLLOW(B) ⊇ FOLLOW(A)
+void SLR1Parser::compute_follow_sets() {
+  const auto &flat = *compiled;
+  size_t count = flat.non_terminals.size();
+  follow_sets.assign(count, Bitset(flat.terminals.size()));
+  std::vector<std::vector<uint32_t>> relation(count);
+
+  // 将#加入到增广文法起始符号的FOLLOW集合
+  follow_sets[0].set(flat.eos());
+
+  for (const auto &production : flat.productions) {
+    uint32_t left = production.non_terminal;
+    uint32_t end = production.offset + production.length;
+    for (uint32_t k = production.offset; k < end; k++) {
+      if (is_terminal(flat.symbols[k].type)) {
+        continue;
+      }
+      uint32_t b = flat.symbol_index[k];
+      bool rest_nullable = true;
+      for (uint32_t j = k + 1; j < end && rest_nullable; j++) {
+        uint32_t index = flat.symbol_index[j];
+        if (is_terminal(flat.symbols[j].type)) {
+          follow_sets[b].set(index);
+          rest_nullable = false;
+        } else {
+          follow_sets[b].merge(first_sets[index]);
+          rest_nullable = analysis.nullable[index];
+        }
+      }
+      if (rest_nullable) {
+        relation[b].push_back(left);
+      }
+    }
+  }
+
+  digraph(relation, follow_sets);
+}
+
+// 左角关系 A -> B：A 有产生式以非终结符 B 开头
+// 闭包集合 C(A) = A 的产生式 ∪ ⋃{ C(B) | A -> B }
+void SLR1Parser::compute_closure_sets() {
+  const auto &flat = *compiled;
+  size_t count = flat.non_terminals.size();
+  closure_sets.assign(count, Bitset(flat.productions.size()));
+  std::vector<std::vector<uint32_t>> relation(count);
+
+  for (uint32_t p = 0; p < flat.productions.size(); p++) {
+    const auto &production = flat.productions[p];
+    uint32_t left = production.non_terminal;
+    closure_sets[left].set(p);
+    if (production.length > 0 &&
+        is_non_terminal(flat.symbols[production.offset].type)) {
+      relation[left].push_back(flat.symbol_index[production.offset]);
+    }
+  }
+
+  digraph(relation, closure_sets);
+}
+
+} // namespace slr
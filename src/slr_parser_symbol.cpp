@@ -6,31 +6,32 @@ namespace slr {
 std::string SLRSymbol::to_string() const {
   switch (type) {
   case SLRSymbolType::TERMINAL:
-    return "'" + value + "'";
+    return "'" + value() + "'";
   case SLRSymbolType::NON_TERMINAL:
-    return "\"" + value + "\"";
+    return "\"" + value() + "\"";
   case SLRSymbolType::SPECIAL_NON_TERMINAL:
-    return value;
+    return value();
   case SLRSymbolType::SPECIAL_TERMINAL:
-    return value;
+    return value();
   default:
     return "unknown";
   }
 }
 
-std::string LR0Item::to_string() const {
+std::string LR0Item::to_string(const CompiledGrammar &grammar) const {
+  auto right = grammar.rhs(production);
   std::stringstream ss;
-  ss << non_terminal << " -> ";
-  for (size_t i = 0; i < production.size(); i++) {
+  ss << grammar::symbol_name(grammar.left(production)) << " -> ";
+  for (size_t i = 0; i < right.size(); i++) {
     if (i == dot_position) {
       ss << ".";
     }
-    ss << production[i].to_string();
-    if (i != production.size() - 1) {
+    ss << right[i].to_string();
+    if (i != right.size() - 1) {
       ss << " ";
     }
   }
-  if (dot_position == production.size()) {
+  if (dot_position == right.size()) {
     ss << ".";
   }
   return ss.str();
@@ -0,0 +1,179 @@
+#include "../include/slr_parser.hpp"
+#include <map>
+
+namespace slr {
+
+// 先放置显式项较多的行，每行取第一个未被占用且各项都落在空位上的位移
+CombTable CombTable::build(const std::vector<Row> &rows,
+                           std::vector<int16_t> defaults,
+                           size_t column_count) {
+  CombTable result;
+  result.defaults = std::move(defaults);
+  result.base.assign(rows.size(), 0);
+
+  std::vector<size_t> order(rows.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return rows[a].size() > rows[b].size();
+  });
+
+  std::map<Row, int32_t> placed;
+  std::vector<bool> used_base;
+  for (size_t r : order) {
+    const Row &row = rows[r];
+    if (auto it = placed.find(row); it != placed.end()) {
+      result.base[r] = it->second;
+      continue;
+    }
+
+    auto fits = [&](size_t b) {
+      if (b < used_base.size() && used_base[b]) {
+        return false;
+      }
+      for (const auto &[column, value] : row) {
+        if (b + column < result.check.size() && result.check[b + column] >= 0) {
+          return false;
+        }
+      }
+      return true;
+    };
+    size_t b = 0;
+    while (!fits(b)) {
+      b++;
+    }
+
+    if (result.check.size() < b + column_count) {
+      result.values.resize(b + column_count, 0);
+      result.check.resize(b + column_count, -1);
+    }
+    if (used_base.size() <= b) {
+      used_base.resize(b + 1, false);
+    }
+    used_base[b] = true;
+    for (const auto &[column, value] : row) {
+      result.values[b + column] = value;
+      result.check[b + column] = static_cast<int16_t>(column);
+    }
+    result.base[r] = static_cast<int32_t>(b);
+    placed.emplace(row, static_cast<int32_t>(b));
+  }
+
+  return result;
+}
+
+// ACTION 的行为状态，列为终结符类，一致状态的默认值为其唯一的归约，其余为出错
+// GOTO 的行为非终结符，列为状态，默认值为该非终结符最常见的目标状态
+bool SLR1Parser::compress_tables() {
+  const auto &flat = *compiled;
+  const size_t limit = INT16_MAX;
+  if (state_count > limit || flat.productions.size() > limit ||
+      flat.terminals.size() > limit) {
+    std::cerr << "分析表超出紧凑表的范围：" << state_count << " 个状态，"
+              << flat.productions.size() << " 个产生式" << std::endl;
+    return false;
+  }
+
+  // columns[t][state] 为终结符 t 在各状态的动作
+  std::vector<std::vector<int16_t>> columns(
+      flat.terminals.size(), std::vector<int16_t>(state_count, 0));
+  std::vector<CombTable::Row> goto_rows(flat.non_terminals.size());
+  for (size_t state = 0; state < state_count; state++) {
+    for (const auto &[symbol, action] : action_table[state]) {
+      int16_t value = ParseTables::ERROR;
+      switch (action.type) {
+      case ActionType::SHIFT:
+        value = ParseTables::shift(action.value);
+        break;
+      case ActionType::REDUCE:
+        value = ParseTables::reduce(static_cast<uint32_t>(action.value));
+        break;
+      case ActionType::ACCEPT:
+        value = ParseTables::ACCEPT;
+        break;
+      case ActionType::ERROR:
+        continue;
+      }
+      columns[flat.terminal_index.at(symbol)][state] = value;
+    }
+
+    for (const auto &[symbol, target] : transitions[state]) {
+      if (is_non_terminal(symbol.type)) {
+        goto_rows[*flat.find_non_terminal(symbol.id)].emplace_back(
+            static_cast<uint32_t>(state), static_cast<int16_t>(target));
+      }
+    }
+  }
+
+  // 动作列相同的终结符归为一类，类按其中第一个终结符的下标编号
+  std::map<std::vector<int16_t>, uint16_t> classes;
+  tables.terminal_class.assign(columns.size(), 0);
+  std::vector<CombTable::Row> action_rows(state_count);
+  for (size_t t = 0; t < columns.size(); t++) {
+    auto [it, created] = classes.emplace(
+        std::move(columns[t]), static_cast<uint16_t>(classes.size()));
+    tables.terminal_class[t] = it->second;
+    if (!created) {
+      continue;
+    }
+    for (size_t state = 0; state < state_count; state++) {
+      if (it->first[state] != ParseTables::ERROR) {
+        action_rows[state].emplace_back(it->second, it->first[state]);
+      }
+    }
+  }
+  tables.class_count = classes.size();
+  tables.byte_class.assign(256, ParseTables::NO_CLASS);
+  for (size_t t = 0; t < flat.terminals.size(); t++) {
+    const auto &symbol = flat.terminals[t];
+    const auto &text = grammar::symbol_name(symbol.id);
+    if (symbol.type == SLRSymbolType::TERMINAL && text.size() == 1) {
+      tables.byte_class[static_cast<unsigned char>(text[0])] =
+          tables.terminal_class[t];
+    }
+  }
+
+  std::vector<int16_t> goto_defaults(goto_rows.size(), 0);
+  std::vector<uint32_t> counts(state_count, 0);
+  for (size_t nt = 0; nt < goto_rows.size(); nt++) {
+    auto &row = goto_rows[nt];
+    uint32_t best = 0;
+    for (const auto &[state, target] : row) {
+      if (++counts[target] > best ||
+          (counts[target] == best && target < goto_defaults[nt])) {
+        best = counts[target];
+        goto_defaults[nt] = target;
+      }
+    }
+    for (const auto &[state, target] : row) {
+      counts[target] = 0;
+    }
+    std::erase_if(row, [&](const auto &entry) {
+      return entry.second == goto_defaults[nt];
+    });
+  }
+
+  // 一致状态：所有显式项都是同一个归约
+  std::vector<int16_t> action_defaults(state_count, ParseTables::ERROR);
+  for (size_t state = 0; state < state_count; state++) {
+    auto &row = action_rows[state];
+    if (row.empty() || row.front().second >= ParseTables::ACCEPT) {
+      continue;
+    }
+    int16_t value = row.front().second;
+    if (std::all_of(row.begin(), row.end(),
+                    [&](const auto &entry) { return entry.second == value; })) {
+      action_defaults[state] = value;
+      row.clear();
+    }
+  }
+
+  tables.action = CombTable::build(action_rows, std::move(action_defaults),
+                                   tables.class_count);
+  tables.gotos =
+      CombTable::build(goto_rows, std::move(goto_defaults), state_count);
+  return true;
+}
+
+} // namespace slr
@@ -1,111 +1,248 @@
 #include "../include/tokenizer.hpp"
 #include <algorithm>
+#include <cstdio>
 #include <iostream>
 
 namespace tokenizer {
 
 std::string Token::to_string() const {
-  return "TK(" + terminal.to_string() + ")";
+  if (!terminal) {
+    // 与终结符的显示方式一致，但不把输入文本放入全局符号表
+    return "TK('" + (value != "\n" ? value : "\\n") + "')";
+  }
+  return "TK(" + terminal->to_string() + ")";
 }
 
-void Tokenizer::sort_terminals() {
-  // 按照终结符长度排序（从长到短）
-  std::sort(terminals.begin(), terminals.end(),
-            [](const grammar::Terminal &a, const grammar::Terminal &b) {
-              return a.value.length() > b.value.length();
-            });
+Lexer::Lexer(const std::vector<grammar::Terminal> &terminals,
+             const grammar::LexicalPromotion &promotion)
+    : terminals(terminals), automaton(terminals, promotion) {
+  init();
 }
 
-// 判断字符串是否全为字母
-bool is_all_letters(const std::string &str) {
-  return std::all_of(str.begin(), str.end(),
-                     [](char c) { return std::isalpha(c); });
+Lexer::Lexer(const std::vector<grammar::Terminal> &terminals,
+             LexerAutomaton automaton)
+    : terminals(terminals), automaton(std::move(automaton)) {
+  init();
 }
 
-// 判断字符是否为字母
-bool is_letter(char c) { return std::isalpha(c); }
-
-bool is_digit(char c) { return '0' <= c && c <= '9'; }
+void Lexer::init() {
+  // 终结符编号使用16位存储，最大的两个值保留给未知终结符与错误token
+  if (terminals.size() >= TokenView::ERROR_TERMINAL) {
+    throw std::runtime_error("Error: Too many terminals to tokenize");
+  }
+  for (size_t i = 0; i < terminals.size(); i++) {
+    if (terminals[i].value() == "'") {
+      quote_terminal = static_cast<uint16_t>(i);
+    }
+  }
+  // 匹配总是从非空白字符开始，初始状态上的空格转移（如字符 ' '）用不到
+  for (size_t state = 1; state < automaton.state_count(); state++) {
+    if (automaton.step(static_cast<int32_t>(state), ' ') !=
+        LexerAutomaton::NO_STATE) {
+      tokens_span_spaces = true;
+    }
+  }
+  // 字符模式下可用的终结符只有单字符与以反斜杠开头的，
+  // 所以只需看初始状态上一步转移的接受信息
+  for (int c = 0; c < 0x80; c++) {
+    if (c == ' ' || c == '\n' || c == '\'' || c == '/' || c == '\\') {
+      continue;
+    }
+    int32_t state = automaton.step(0, static_cast<unsigned char>(c));
+    char_mode_plain[c] = state == LexerAutomaton::NO_STATE ||
+                         automaton.accepts[state].terminal ==
+                             LexerAutomaton::NO_TERMINAL ||
+                         !automaton.accepts[state].char_mode_ok;
+  }
+}
 
-std::optional<Token> Tokenizer::next_token() {
-  // 如果已经处理完所有输入，则返回空
-  if (is_end()) {
-    return std::nullopt;
+Token Lexer::to_token(const TokenView &view, std::string_view text) const {
+  if (view.terminal_id != TokenView::UNKNOWN_TERMINAL &&
+      view.terminal_id != TokenView::ERROR_TERMINAL) {
+    const grammar::Terminal &terminal = terminals[view.terminal_id];
+    // 记号的值是其识别到的文本
+    if (terminal.is_token) {
+      return Token(strip_layout(text), terminal);
+    }
+    return Token(terminal.value(), terminal);
   }
+  // 字符模式下的普通字符与错误token以原始文本为值
+  return Token(std::string(text), std::nullopt);
+}
 
-  // 遇到空格或换行符时，跳过它们
-  while (position < input.size() &&
-         (input[position] == ' ' || input[position] == '\n')) {
-    position++;
+Tokenizer::Tokenizer(Lexer lexer, SourceBuffer source)
+    : lexer(std::move(lexer)), source(std::move(source)), position(0) {
+  // 切片使用32位偏移
+  if (this->source.size() > UINT32_MAX) {
+    throw std::runtime_error("Error: Input is too large to tokenize");
   }
+}
 
-  // 检查是否遇到单引号
-  if (input[position] == '\'') {
-    this->in_char_mode = !this->in_char_mode;
-    position++;
-    return Token("\'", grammar::Terminal("\'")); // 返回单引号token
+std::string LexDiagnostic::describe() const {
+  // 不可打印的字节以十六进制显示
+  auto value = static_cast<unsigned char>(byte);
+  char hex[8];
+  std::snprintf(hex, sizeof(hex), "\\x%02X", value);
+  if (kind == LexErrorKind::INVALID_UTF8) {
+    return std::string("Invalid UTF-8 sequence starting with byte ") + hex;
   }
+  bool printable = value >= 0x20 && value < 0x7F;
+  return "Unexpected character '" +
+         (printable ? std::string(1, byte) : std::string(hex)) + "'";
+}
 
-  if (this->in_char_mode) {
-    // 在字符模式下，只匹配以反斜杠开头的terminal和单字符terminal
-    for (const auto &terminal : terminals) {
-      const std::string &term_value = terminal.value;
+std::vector<LexDiagnostic> Tokenizer::check_utf8(size_t begin,
+                                                 size_t end) const {
+  std::vector<LexDiagnostic> invalid;
+  if (!lexer.utf8) {
+    return invalid;
+  }
+  std::string_view input = source.view();
+  size_t pos = begin;
+  while (true) {
+    pos += simd::validate_utf8(input.data() + pos, end - pos);
+    if (pos >= end) {
+      break;
+    }
+    if (!error_tolerant) {
+      auto location = locate(pos);
+      std::cerr << "Error: Invalid UTF-8 sequence at line " << location.line
+                << ", column " << location.column << std::endl;
+      throw std::runtime_error("Error: Invalid UTF-8 sequence");
+    }
+    // 与 Lexer::recover 相同，跳过出错的字节及其后的 UTF-8 后续字节
+    // 整体校验时不知道所处的字符模式，记为普通模式
+    size_t start = pos++;
+    while (pos < end &&
+           (static_cast<unsigned char>(input[pos]) & 0xC0) == 0x80) {
+      pos++;
+    }
+    invalid.push_back(LexDiagnostic{start, input[start], false,
+                                    LexErrorKind::INVALID_UTF8,
+                                    static_cast<uint32_t>(pos - start)});
+  }
+  return invalid;
+}
 
-      // 跳过长度大于1的非转义序列
-      if (term_value.length() > 1 && term_value[0] != '\\') {
-        continue;
-      }
+void Tokenizer::merge_diagnostics(std::vector<LexDiagnostic> &diagnostics,
+                                  const std::vector<LexDiagnostic> &invalid) {
+  if (invalid.empty()) {
+    return;
+  }
+  std::unordered_set<size_t> reported;
+  for (const auto &diagnostic : diagnostics) {
+    reported.insert(diagnostic.offset);
+  }
+  for (const auto &diagnostic : invalid) {
+    if (!reported.contains(diagnostic.offset)) {
+      diagnostics.push_back(diagnostic);
+    }
+  }
+  std::stable_sort(diagnostics.begin(), diagnostics.end(),
+                   [](const LexDiagnostic &a, const LexDiagnostic &b) {
+                     return a.offset < b.offset;
+                   });
+}
 
-      // 如果剩余输入长度小于终结符长度，则跳过
-      if (position + term_value.length() > input.size()) {
-        continue;
+TokenStream Tokenizer::tokenize() {
+  auto invalid = check_utf8(position, source.size());
+  TokenStream stream;
+  stream.source = source.view();
+  std::string_view input = source.view();
+  size_t quote = 0; // 字符模式下下一个单引号的位置
+  bool mode = in_char_mode;
+  while (true) {
+    // 字符字面量中的普通字符不经过自动机，逐个作为普通字符直到下一个单引号
+    if (in_char_mode) {
+      if (quote <= position) {
+        quote = position + simd::find_byte(input.data() + position,
+                                           input.size() - position, '\'');
       }
-
-      // 尝试匹配
-      std::string substr = input.substr(position, term_value.length());
-      if (substr == term_value) {
-        position += term_value.length();
-        return Token(substr, terminal);
+      while (position < quote && lexer.is_plain_char(input[position])) {
+        stream.push_back(TokenView{TokenView::UNKNOWN_TERMINAL, position, 1},
+                         true);
+        position++;
       }
     }
+    auto view = next_view();
+    if (!view) {
+      break;
+    }
+    stream.push_back(*view, mode);
+    mode = in_char_mode;
+  }
+  merge_diagnostics(diagnostics, invalid);
+  return stream;
+}
 
-    // 在字符模式下，如果没有匹配到特殊字符，则作为普通字符处理
-    std::string char_str(1, input[position]);
-    position++;
-    return Token(char_str, grammar::Terminal(char_str));
-  } else {
-    // 正常模式下的匹配逻辑
-    for (const auto &terminal : terminals) {
-      const std::string &term_value = terminal.value;
-
-      if (position + term_value.length() > input.size()) {
-        continue;
-      }
+bool in_comment_line(std::string_view input, size_t pos) {
+  size_t newline = input.rfind('\n', pos == 0 ? 0 : pos - 1);
+  size_t line_start = newline == std::string_view::npos || newline >= pos
+                          ? 0
+                          : newline + 1;
+  return input.substr(line_start, 2) == "//";
+}
 
-      std::string substr = input.substr(position, term_value.length());
-      if (substr == term_value) {
-        if (is_all_letters(term_value) && term_value.size() != 1) {
-          // 如果紧跟的下一个字符是字母/数字/下划线，说明是标识符，跳过
-          size_t next_pos = position + term_value.length();
-          if (next_pos < input.size() &&
-              (is_letter(input[next_pos]) || is_digit(input[next_pos]) ||
-               input[next_pos] == '_')) {
-            continue; // 跳过标识符
-          }
-        }
-        position += term_value.length();
-        return Token(substr, terminal);
-      }
+std::string strip_layout(std::string_view text) {
+  std::string result;
+  result.reserve(text.size());
+  for (size_t i = 0; i < text.size(); i++) {
+    if (text[i] == '\n') {
+      continue;
+    }
+    // 换行后以//开头的注释行
+    if (i > 0 && text[i - 1] == '\n' && text.substr(i, 2) == "//") {
+      size_t end = text.find('\n', i);
+      i = (end == std::string_view::npos ? text.size() : end) - 1;
+      continue;
     }
+    result.push_back(text[i]);
+  }
+  return result;
+}
+
+void TokenStream::push_back(const TokenView &view, bool char_mode) {
+  if (view.offset > UINT32_MAX) {
+    throw std::runtime_error("Error: Token does not fit in token stream");
+  }
+  terminal_ids.push_back(view.terminal_id);
+  offsets.push_back(static_cast<uint32_t>(view.offset));
+  lengths.push_back(view.length);
+  char_modes.push_back(char_mode);
+}
+
+void TokenStream::splice(size_t begin, size_t end,
+                         const TokenStream &replacement, int64_t delta) {
+  auto replace = [&](auto &column, const auto &with) {
+    column.erase(column.begin() + begin, column.begin() + end);
+    column.insert(column.begin() + begin, with.begin(), with.end());
+  };
+  replace(terminal_ids, replacement.terminal_ids);
+  replace(offsets, replacement.offsets);
+  replace(lengths, replacement.lengths);
+  replace(char_modes, replacement.char_modes);
+  for (size_t i = begin + replacement.size(); i < offsets.size(); i++) {
+    offsets[i] = static_cast<uint32_t>(offsets[i] + delta);
+  }
+}
+
+void TokenStream::append(const TokenStream &other, size_t begin, size_t end) {
+  terminal_ids.insert(terminal_ids.end(), other.terminal_ids.begin() + begin,
+                      other.terminal_ids.begin() + end);
+  offsets.insert(offsets.end(), other.offsets.begin() + begin,
+                 other.offsets.begin() + end);
+  lengths.insert(lengths.end(), other.lengths.begin() + begin,
+                 other.lengths.begin() + end);
+  char_modes.insert(char_modes.end(), other.char_modes.begin() + begin,
+                    other.char_modes.begin() + end);
+}
 
-    // 如果没有匹配到任何终结符，则报错并跳过当前字符
-    std::cerr << "Error: Unexpected character '" << input[position]
-              << "' at position " << position << std::endl;
-    position++;
-    std::cerr << "Now string mode is " << this->in_char_mode << std::endl;
-    throw std::runtime_error("Error: Unexpected character");
-    return next_token(); // 递归调用，尝试匹配下一个字符
+std::optional<Token> Tokenizer::next_token() {
+  auto view = next_view();
+  if (!view) {
+    return std::nullopt;
   }
+  return to_token(*view);
 }
 
-} // namespace tokenizer
\ No newline at end of file
+} // namespace tokenizer
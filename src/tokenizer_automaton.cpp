@@ -0,0 +1,199 @@
+#include "../include/tokenizer.hpp"
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+
+namespace tokenizer {
+
+// 判断字符串是否全为字母
+static bool is_all_letters(const std::string &str) {
+  return std::all_of(str.begin(), str.end(),
+                     [](char c) { return has_byte_flag(c, BYTE_LETTER); });
+}
+
+// NFA 状态集合的空转移闭包，结果有序以便作为子集构造的键
+static std::vector<int> epsilon_closure(const grammar::ByteNfa &nfa,
+                                        std::vector<int> states) {
+  std::vector<bool> seen(nfa.states.size(), false);
+  std::vector<int> stack;
+  for (int s : states) {
+    if (!seen[s]) {
+      seen[s] = true;
+      stack.push_back(s);
+    }
+  }
+  std::vector<int> result;
+  while (!stack.empty()) {
+    int s = stack.back();
+    stack.pop_back();
+    result.push_back(s);
+    for (int next : nfa.states[s].epsilon) {
+      if (!seen[next]) {
+        seen[next] = true;
+        stack.push_back(next);
+      }
+    }
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+LexerAutomaton::LexerAutomaton(
+    const std::vector<grammar::Terminal> &terminals,
+    const grammar::LexicalPromotion &promotion) {
+  // 先把字面终结符的字典树与各记号的自动机合并为一个 NFA
+  grammar::ByteNfa nfa;
+  int root = nfa.add_state();
+  int trie_root = nfa.add_state();
+  nfa.states[root].epsilon.push_back(trie_root);
+  std::vector<int32_t> nfa_literal(nfa.states.size(), NO_TERMINAL);
+  std::vector<int32_t> nfa_token(nfa.states.size(), NO_TERMINAL);
+  std::map<std::pair<int, unsigned char>, int> trie_edges;
+
+  for (size_t i = 0; i < terminals.size(); i++) {
+    const std::string &value = terminals[i].value();
+    // 空终结符无法被词法分析器识别，记号终结符由下面的自动机识别
+    if (value.empty() || terminals[i].is_token) {
+      continue;
+    }
+
+    int state = trie_root;
+    for (char c : value) {
+      auto key = std::make_pair(state, static_cast<unsigned char>(c));
+      auto it = trie_edges.find(key);
+      if (it == trie_edges.end()) {
+        int next = nfa.add_state();
+        nfa.states[state].edges.emplace_back(key.second, next);
+        nfa_literal.push_back(NO_TERMINAL);
+        nfa_token.push_back(NO_TERMINAL);
+        it = trie_edges.emplace(key, next).first;
+      }
+      state = it->second;
+    }
+    nfa_literal[state] = static_cast<int32_t>(i);
+  }
+
+  for (const auto &token : promotion.tokens) {
+    int32_t id = NO_TERMINAL;
+    for (size_t i = 0; i < terminals.size(); i++) {
+      if (terminals[i].is_token && terminals[i].value() == token.name) {
+        id = static_cast<int32_t>(i);
+      }
+    }
+    if (id == NO_TERMINAL) {
+      continue;
+    }
+
+    int offset = static_cast<int>(nfa.states.size());
+    for (const auto &state : token.nfa.states) {
+      grammar::ByteNfa::State shifted;
+      for (const auto &[byte, next] : state.edges) {
+        shifted.edges.emplace_back(byte, next + offset);
+      }
+      for (int next : state.epsilon) {
+        shifted.epsilon.push_back(next + offset);
+      }
+      nfa.states.push_back(std::move(shifted));
+      nfa_literal.push_back(NO_TERMINAL);
+      nfa_token.push_back(NO_TERMINAL);
+    }
+    nfa.states[root].epsilon.push_back(token.nfa.start + offset);
+    nfa_token[token.nfa.accept + offset] = id;
+  }
+
+  std::vector<bool> helper(terminals.size(), false);
+  for (const auto &terminal : promotion.helper_terminals) {
+    for (size_t i = 0; i < terminals.size(); i++) {
+      if (terminals[i] == terminal) {
+        helper[i] = true;
+      }
+    }
+  }
+
+  // 子集构造，得到按字节转移的确定性自动机
+  std::vector<int32_t> dense; // 状态 x 字节 -> 状态
+  std::vector<Accept> dfa_accepts;
+  std::map<std::vector<int>, int32_t> dfa_states;
+  std::vector<std::vector<int>> pending;
+  auto intern = [&](std::vector<int> set) {
+    auto it = dfa_states.find(set);
+    if (it != dfa_states.end()) {
+      return it->second;
+    }
+    int32_t state = static_cast<int32_t>(dfa_accepts.size());
+    dense.resize(dense.size() + 256, NO_STATE);
+    dfa_accepts.emplace_back();
+    Accept &accept = dfa_accepts[state];
+    for (int s : set) {
+      if (nfa_literal[s] != NO_TERMINAL) {
+        const std::string &value = terminals[nfa_literal[s]].value();
+        accept.terminal = nfa_literal[s];
+        accept.keyword_like = is_all_letters(value) && value.size() != 1;
+        accept.char_mode_ok = value.size() == 1 || value[0] == '\\';
+        accept.helper = helper[nfa_literal[s]];
+      }
+      if (nfa_token[s] != NO_TERMINAL &&
+          (accept.token == NO_TERMINAL || nfa_token[s] < accept.token)) {
+        accept.token = nfa_token[s];
+      }
+    }
+    dfa_states.emplace(set, state);
+    pending.push_back(std::move(set));
+    return state;
+  };
+
+  intern(epsilon_closure(nfa, {root}));
+  for (int32_t state = 0; static_cast<size_t>(state) < pending.size();
+       state++) {
+    std::vector<std::vector<int>> targets(256);
+    for (int s : pending[state]) {
+      for (const auto &[byte, next] : nfa.states[s].edges) {
+        targets[byte].push_back(next);
+      }
+    }
+    for (size_t byte = 0; byte < 256; byte++) {
+      if (targets[byte].empty()) {
+        continue;
+      }
+      int32_t next = intern(epsilon_closure(nfa, std::move(targets[byte])));
+      dense[static_cast<size_t>(state) * 256 + byte] = next;
+    }
+  }
+
+  // 按列压缩：所有状态上转移都相同的字节归为同一字节类
+  auto table = std::make_shared<Storage>();
+  size_t state_total = dfa_accepts.size();
+  std::map<std::vector<int32_t>, uint8_t> columns;
+  std::vector<std::vector<int32_t>> class_columns;
+  table->byte_classes.resize(256);
+  for (size_t byte = 0; byte < 256; byte++) {
+    std::vector<int32_t> column(state_total);
+    for (size_t state = 0; state < state_total; state++) {
+      column[state] = dense[state * 256 + byte];
+    }
+    auto it = columns.find(column);
+    if (it == columns.end()) {
+      it = columns.emplace(column, static_cast<uint8_t>(class_columns.size()))
+               .first;
+      class_columns.push_back(column);
+    }
+    table->byte_classes[byte] = it->second;
+  }
+  table->transitions.resize(state_total * class_columns.size());
+  for (size_t state = 0; state < state_total; state++) {
+    for (size_t cls = 0; cls < class_columns.size(); cls++) {
+      table->transitions[state * class_columns.size() + cls] =
+          class_columns[cls][state];
+    }
+  }
+  table->accepts = std::move(dfa_accepts);
+
+  byte_classes = table->byte_classes.data();
+  transitions = table->transitions.data();
+  accepts = table->accepts.data();
+  class_count = class_columns.size();
+  states = state_total;
+  storage = std::move(table);
+}
+
+} // namespace tokenizer
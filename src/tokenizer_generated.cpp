@@ -0,0 +1,37 @@
+#include "../include/tokenizer.hpp"
+
+// 生成表由 make lexer-tables 产生，不存在时只能在运行时构建自动机
+#if __has_include("../include/lexer_tables.hpp")
+#include "../include/lexer_tables.hpp"
+#define HAS_GENERATED_LEXER_TABLES 1
+#else
+#define HAS_GENERATED_LEXER_TABLES 0
+#endif
+
+namespace tokenizer {
+
+std::optional<Lexer>
+Lexer::from_generated(const std::vector<grammar::Terminal> &terminals,
+                      uint64_t grammar_hash) {
+#if HAS_GENERATED_LEXER_TABLES
+  if (generated::GRAMMAR_HASH != grammar_hash ||
+      generated::TABLES_VERSION != LEXER_TABLES_VERSION ||
+      generated::TERMINAL_COUNT != terminals.size()) {
+    return std::nullopt;
+  }
+  for (size_t i = 0; i < terminals.size(); i++) {
+    if (terminals[i].value() != generated::TERMINAL_VALUES[i] ||
+        terminals[i].is_token != generated::TERMINAL_IS_TOKEN[i]) {
+      return std::nullopt;
+    }
+  }
+  return Lexer(terminals,
+               LexerAutomaton(generated::STATE_COUNT, generated::CLASS_COUNT,
+                              generated::BYTE_CLASSES, generated::TRANSITIONS,
+                              generated::ACCEPTS));
+#else
+  return std::nullopt;
+#endif
+}
+
+} // namespace tokenizer
@@ -0,0 +1,130 @@
+#include "../include/tokenizer.hpp"
+#include <algorithm>
+
+namespace tokenizer {
+
+void Tokenizer::apply_edit(TokenStream &tokens, const TextEdit &edit) {
+  if (edit.offset > source.size() ||
+      edit.deleted > source.size() - edit.offset) {
+    throw std::runtime_error("Error: Edit is out of range");
+  }
+  if (source.size() - edit.deleted + edit.inserted.size() > UINT32_MAX) {
+    throw std::runtime_error("Error: Input is too large to tokenize");
+  }
+  source.replace(edit.offset, edit.deleted, edit.inserted);
+  line_index.reset();
+  std::string_view input = source.view();
+
+  // 空格可能出现在token内部，或token流缺少字符模式时，只能整体重新分析
+  if (lexer.tokens_span_spaces || tokens.char_modes.size() != tokens.size()) {
+    position = 0;
+    in_char_mode = false;
+    diagnostics.clear();
+    tokens = tokenize();
+    return;
+  }
+
+  // 重新开始的位置：编辑位置之前、不在注释行中的空格，且此时不在字符模式
+  // 空格不会出现在token内部，匹配它之前的token时不会读到它之后的输入
+  size_t restart = 0;
+  size_t kept = 0; // 保留的旧token个数，它们都在 restart 之前
+  for (size_t pos = edit.offset; pos > 0;) {
+    size_t space = input.rfind(' ', pos - 1);
+    if (space == std::string_view::npos) {
+      break;
+    }
+    pos = space;
+    if (in_comment_line(input, space)) {
+      continue;
+    }
+    size_t count = static_cast<size_t>(
+        std::lower_bound(tokens.offsets.begin(), tokens.offsets.end(), space) -
+        tokens.offsets.begin());
+    bool mode = count > 0 && (tokens.char_modes[count - 1] !=
+                              (tokens.terminal_ids[count - 1] ==
+                               lexer.quote_terminal));
+    if (!mode) {
+      restart = space;
+      kept = count;
+      break;
+    }
+  }
+
+  // 从 restart 开始重新分析，直到新token与编辑区之后的某个旧token重合
+  // 重合的token偏移、终结符、长度与之前的字符模式都相同，之后的结果必然不变
+  int64_t delta = static_cast<int64_t>(edit.inserted.size()) -
+                  static_cast<int64_t>(edit.deleted);
+  size_t edit_end = edit.offset + edit.deleted; // 编辑区在旧输入中的结束位置
+  TokenStream fresh;
+  std::vector<LexDiagnostic> fresh_diagnostics;
+  BufferReader reader{input};
+  size_t pos = restart;
+  bool mode = false;
+  size_t old = kept;
+  size_t resync = tokens.size();
+  while (true) {
+    bool before = mode;
+    auto view = error_tolerant ? lexer.scan_tolerant(reader, pos, mode,
+                                                     fresh_diagnostics)
+                               : lexer.scan(reader, pos, mode);
+    if (!view) {
+      break;
+    }
+    while (old < tokens.size() &&
+           (tokens.offsets[old] < edit_end ||
+            static_cast<int64_t>(tokens.offsets[old]) + delta <
+                static_cast<int64_t>(view->offset))) {
+      old++;
+    }
+    if (old < tokens.size() && tokens.offsets[old] >= edit_end &&
+        static_cast<int64_t>(tokens.offsets[old]) + delta ==
+            static_cast<int64_t>(view->offset) &&
+        tokens.terminal_ids[old] == view->terminal_id &&
+        tokens.lengths[old] == view->length &&
+        tokens.char_modes[old] == before) {
+      resync = old;
+      if (view->terminal_id == TokenView::ERROR_TERMINAL) {
+        fresh_diagnostics.pop_back(); // 旧的诊断信息会被保留
+      }
+      break;
+    }
+    fresh.push_back(*view, before);
+  }
+  if (resync == tokens.size()) {
+    in_char_mode = mode;
+  }
+
+  // 重新校验重新分析的区间，其中注释里的非法序列也要报告
+  size_t fresh_end =
+      resync < tokens.size()
+          ? static_cast<size_t>(static_cast<int64_t>(tokens.offsets[resync]) +
+                                delta)
+          : input.size();
+  merge_diagnostics(fresh_diagnostics, check_utf8(restart, fresh_end));
+
+  // 更新诊断信息：重新分析区间内的换成新的，之后的平移
+  size_t resync_offset =
+      resync < tokens.size() ? tokens.offsets[resync] : SIZE_MAX;
+  std::vector<LexDiagnostic> updated;
+  for (const auto &diagnostic : diagnostics) {
+    if (diagnostic.offset < restart) {
+      updated.push_back(diagnostic);
+    }
+  }
+  updated.insert(updated.end(), fresh_diagnostics.begin(),
+                 fresh_diagnostics.end());
+  for (auto diagnostic : diagnostics) {
+    if (diagnostic.offset >= resync_offset) {
+      diagnostic.offset = static_cast<size_t>(
+          static_cast<int64_t>(diagnostic.offset) + delta);
+      updated.push_back(diagnostic);
+    }
+  }
+  diagnostics = std::move(updated);
+
+  tokens.splice(kept, resync, fresh, delta);
+  tokens.source = input;
+  position = input.size();
+}
+
+} // namespace tokenizer
@@ -0,0 +1,33 @@
+#include "../include/tokenizer.hpp"
+#include <algorithm>
+
+namespace tokenizer {
+
+LineIndex::LineIndex(std::string_view source) {
+  line_starts.push_back(0);
+  size_t pos = 0;
+  while (true) {
+    pos += simd::find_byte(source.data() + pos, source.size() - pos, '\n');
+    if (pos >= source.size()) {
+      break;
+    }
+    pos++;
+    line_starts.push_back(pos);
+  }
+}
+
+SourceLocation LineIndex::locate(size_t offset) const {
+  // 最后一个不大于 offset 的行首
+  auto it = std::upper_bound(line_starts.begin(), line_starts.end(), offset);
+  size_t line = static_cast<size_t>(it - line_starts.begin());
+  return SourceLocation{line, offset - line_starts[line - 1] + 1};
+}
+
+SourceLocation Tokenizer::locate(size_t offset) const {
+  if (!line_index) {
+    line_index = std::make_unique<LineIndex>(source.view());
+  }
+  return line_index->locate(offset);
+}
+
+} // namespace tokenizer
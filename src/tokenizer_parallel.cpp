@@ -0,0 +1,171 @@
+#include "../include/tokenizer.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <thread>
+
+namespace tokenizer {
+
+namespace {
+
+// 每块至少的字节数，输入太小时切分得不偿失
+constexpr size_t MIN_CHUNK_SIZE = 256 * 1024;
+
+// 一块输入从某个字符模式开始的分析结果
+struct ChunkRun {
+  TokenStream tokens;     // 块内的token
+  bool end_mode = false;  // 分析完后的字符模式
+  bool failed = false;    // 是否遇到无法匹配的字符
+  size_t error_position = 0;
+  std::vector<LexDiagnostic> diagnostics; // 容错模式下的词法错误
+  std::exception_ptr error; // 分析过程中抛出的其它异常
+};
+
+// 从 pos 开始查找可以作为切分点的空格：不在注释行中，且不紧挨单引号
+// 这样切分点一定是token边界，并且通常不在字符字面量里
+size_t find_split(std::string_view input, size_t pos, size_t limit) {
+  while (pos < limit) {
+    const void *space = memchr(input.data() + pos, ' ', limit - pos);
+    if (space == nullptr) {
+      return limit;
+    }
+    pos = static_cast<size_t>(static_cast<const char *>(space) - input.data());
+    if (in_comment_line(input, pos)) {
+      const void *newline = memchr(input.data() + pos, '\n', limit - pos);
+      if (newline == nullptr) {
+        return limit;
+      }
+      pos = static_cast<size_t>(static_cast<const char *>(newline) -
+                                input.data());
+      continue;
+    }
+    bool near_quote = input[pos - 1] == '\'' ||
+                      (pos + 1 < input.size() && input[pos + 1] == '\'');
+    if (!near_quote) {
+      return pos;
+    }
+    pos++;
+  }
+  return limit;
+}
+
+// 从 start 以给定字符模式分析，直到下一个token起始于 end 之后
+// tolerant 为真时遇到无法识别的字符产生错误token并继续
+void run_chunk(const Lexer &lexer, std::string_view input, size_t start,
+               size_t end, bool mode, bool tolerant, ChunkRun &run) try {
+  BufferReader reader{input};
+  run.tokens.source = input;
+  size_t position = start;
+  bool in_char_mode = mode;
+  while (true) {
+    bool before = in_char_mode;
+    TokenView view{};
+    ScanStatus status = lexer.match(reader, position, in_char_mode, view);
+    if (status == ScanStatus::END) {
+      break;
+    }
+    if (status == ScanStatus::UNEXPECTED) {
+      if (position >= end) {
+        break;
+      }
+      if (!tolerant) {
+        run.failed = true;
+        run.error_position = position;
+        break;
+      }
+      view = lexer.recover(reader, position, in_char_mode, run.diagnostics);
+    }
+    if (view.offset >= end) {
+      in_char_mode = before;
+      break;
+    }
+    run.tokens.push_back(view, before);
+  }
+  run.end_mode = in_char_mode;
+} catch (...) {
+  run.error = std::current_exception();
+}
+
+} // namespace
+
+TokenStream Tokenizer::tokenize_parallel(size_t thread_count) {
+  std::string_view input = source.view();
+  if (thread_count == 0) {
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+  }
+  thread_count =
+      std::min(thread_count, (input.size() - position) / MIN_CHUNK_SIZE);
+  // 只有空格一定是token边界时才能切分
+  if (thread_count <= 1 || lexer.tokens_span_spaces) {
+    return tokenize();
+  }
+  // 先整体校验编码，非容错时各块内不会再遇到非法序列
+  auto invalid = check_utf8(position, input.size());
+
+  // 切分点：每块的起始位置，最后一个为输入末尾
+  std::vector<size_t> bounds{position};
+  size_t step = (input.size() - position) / thread_count;
+  for (size_t i = 1; i < thread_count; i++) {
+    size_t target = std::max(position + i * step, bounds.back() + 1);
+    size_t split = find_split(input, target, input.size());
+    if (split >= input.size()) {
+      break;
+    }
+    bounds.push_back(split);
+  }
+  bounds.push_back(input.size());
+  size_t chunk_count = bounds.size() - 1;
+
+  // 块开始时的字符模式要等前一块分析完才知道，
+  // 所以除第一块外每块同时从两种字符模式开始分析，拼接时取实际模式的结果
+  // runs[i][mode] 为第 i 块从该字符模式开始的结果
+  std::vector<std::array<ChunkRun, 2>> runs(chunk_count);
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < chunk_count; i++) {
+    for (bool mode : {false, true}) {
+      if (i == 0 && mode != in_char_mode) {
+        continue;
+      }
+      workers.emplace_back([&, i, mode] {
+        run_chunk(lexer, input, bounds[i], bounds[i + 1], mode,
+                  error_tolerant, runs[i][mode]);
+      });
+    }
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+
+  // 按实际的字符模式依次拼接
+  TokenStream stream;
+  stream.source = input;
+  size_t total = 0;
+  for (const auto &run : runs) {
+    total += std::max(run[0].tokens.size(), run[1].tokens.size());
+  }
+  stream.reserve(total);
+  bool mode = in_char_mode;
+  for (size_t i = 0; i < chunk_count; i++) {
+    const ChunkRun &run = runs[i][mode];
+    if (run.error) {
+      std::rethrow_exception(run.error);
+    }
+    stream.append(run.tokens, 0, run.tokens.size());
+    diagnostics.insert(diagnostics.end(), run.diagnostics.begin(),
+                       run.diagnostics.end());
+    if (run.failed) {
+      // 从出错位置重新匹配，以与顺序分析相同的方式报错
+      position = run.error_position;
+      in_char_mode = run.end_mode;
+      next_view();
+    }
+    mode = run.end_mode;
+  }
+
+  merge_diagnostics(diagnostics, invalid);
+  position = input.size();
+  in_char_mode = mode;
+  return stream;
+}
+
+} // namespace tokenizer
@@ -0,0 +1,390 @@
+#include "../include/tokenizer_simd.hpp"
+#include <atomic>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TOKENIZER_SIMD_X86 1
+#endif
+
+namespace tokenizer::simd {
+
+namespace {
+
+size_t find_non_blank_scalar(const char *data, size_t size) {
+  size_t i = 0;
+  while (i < size && (data[i] == ' ' || data[i] == '\n')) {
+    i++;
+  }
+  return i;
+}
+
+size_t find_byte_scalar(const char *data, size_t size, char byte) {
+  size_t i = 0;
+  while (i < size && data[i] != byte) {
+    i++;
+  }
+  return i;
+}
+
+// 从 i 开始的 UTF-8 序列长度，非法时为 0
+size_t sequence_at(const char *data, size_t size, size_t i) {
+  return utf8_sequence_length(
+      reinterpret_cast<const unsigned char *>(data) + i, size - i);
+}
+
+size_t validate_utf8_scalar(const char *data, size_t size) {
+  size_t i = 0;
+  while (i < size) {
+    if (static_cast<unsigned char>(data[i]) < 0x80) {
+      i++;
+      continue;
+    }
+    size_t length = sequence_at(data, size, i);
+    if (length == 0) {
+      return i;
+    }
+    i += length;
+  }
+  return size;
+}
+
+#ifdef TOKENIZER_SIMD_X86
+
+// SSE4.2：PCMPESTRI 一次比较16字节与字符集合
+__attribute__((target("sse4.2"))) size_t
+find_non_blank_sse42(const char *data, size_t size) {
+  const __m128i blanks = _mm_setr_epi8(' ', '\n', 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                       0, 0, 0, 0, 0);
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    __m128i block =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+    int index = _mm_cmpestri(blanks, 2, block, 16,
+                             _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY |
+                                 _SIDD_NEGATIVE_POLARITY |
+                                 _SIDD_LEAST_SIGNIFICANT);
+    if (index < 16) {
+      return i + static_cast<size_t>(index);
+    }
+  }
+  return i + find_non_blank_scalar(data + i, size - i);
+}
+
+__attribute__((target("sse4.2"))) size_t
+find_byte_sse42(const char *data, size_t size, char byte) {
+  const __m128i needle = _mm_set1_epi8(byte);
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    __m128i block =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+    int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+    if (mask != 0) {
+      return i + static_cast<size_t>(__builtin_ctz(mask));
+    }
+  }
+  return i + find_byte_scalar(data + i, size - i, byte);
+}
+
+// AVX2：每次比较32字节，掩码取反后第一个置位即第一个非空白字节
+__attribute__((target("avx2"))) size_t find_non_blank_avx2(const char *data,
+                                                           size_t size) {
+  const __m256i space = _mm256_set1_epi8(' ');
+  const __m256i newline = _mm256_set1_epi8('\n');
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    __m256i block =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+    __m256i blank = _mm256_or_si256(_mm256_cmpeq_epi8(block, space),
+                                    _mm256_cmpeq_epi8(block, newline));
+    uint32_t mask = ~static_cast<uint32_t>(_mm256_movemask_epi8(blank));
+    if (mask != 0) {
+      return i + static_cast<size_t>(__builtin_ctz(mask));
+    }
+  }
+  return i + find_non_blank_sse42(data + i, size - i);
+}
+
+__attribute__((target("avx2"))) size_t find_byte_avx2(const char *data,
+                                                      size_t size, char byte) {
+  const __m256i needle = _mm256_set1_epi8(byte);
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    __m256i block =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+    uint32_t mask = static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)));
+    if (mask != 0) {
+      return i + static_cast<size_t>(__builtin_ctz(mask));
+    }
+  }
+  return i + find_byte_sse42(data + i, size - i, byte);
+}
+
+// 查表法校验 UTF-8（Keiser 与 Lemire）：每个字节与它前面的字节组成一对，
+// 按前一字节的高、低半字节与当前字节的高半字节查三张16项的表，
+// 三个结果按位与之后非零即这一对字节可能构成的错误，
+// 其中 TWO_CONTS 表示两个连续的后续字节，只在多字节字符的第2、3个后续字节处合法
+namespace utf8_lookup {
+constexpr uint8_t TOO_SHORT = 1 << 0;  // 前导字节后面不是后续字节
+constexpr uint8_t TOO_LONG = 1 << 1;   // ASCII 后面是后续字节
+constexpr uint8_t OVERLONG_3 = 1 << 2; // 11100000 100_____
+constexpr uint8_t TOO_LARGE = 1 << 3;  // 超出 U+10FFFF
+constexpr uint8_t SURROGATE = 1 << 4;  // 11101101 101_____
+constexpr uint8_t OVERLONG_2 = 1 << 5; // 1100000_ 10______
+constexpr uint8_t TOO_LARGE_1000 = 1 << 6;
+constexpr uint8_t OVERLONG_4 = 1 << 6; // 11110000 1000____
+constexpr uint8_t TWO_CONTS = 1 << 7;  // 10______ 10______
+constexpr uint8_t CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+// 前一字节的高半字节
+alignas(16) constexpr uint8_t BYTE_1_HIGH[16] = {
+    TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+    TOO_LONG, TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+    TOO_SHORT | OVERLONG_2, TOO_SHORT, TOO_SHORT | OVERLONG_3 | SURROGATE,
+    TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4};
+
+// 前一字节的低半字节
+alignas(16) constexpr uint8_t BYTE_1_LOW[16] = {
+    CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+    CARRY | OVERLONG_2,
+    CARRY,
+    CARRY,
+    CARRY | TOO_LARGE,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000};
+
+// 当前字节的高半字节
+alignas(16) constexpr uint8_t BYTE_2_HIGH[16] = {
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+    TOO_SHORT, TOO_SHORT,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 |
+        OVERLONG_4,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT};
+
+// 块末尾的字节超过对应位置的值时，其所在的多字节字符延续到下一块
+alignas(32) constexpr uint8_t INCOMPLETE_MAX[32] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1};
+} // namespace utf8_lookup
+
+// 分块校验在 block 处发现错误或处理完所有整块后，
+// 从 block 所在序列的开头逐字节解码，给出第一个非法序列的准确位置
+// block 之前的字节都已校验，只有最后一个字符可能延续到 block 之后，
+// 它的前导字节就是 block 前3个字节中第一个不是后续字节的字节
+size_t validate_utf8_from(const char *data, size_t size, size_t block) {
+  size_t start = block < 3 ? 0 : block - 3;
+  while (start < block && (static_cast<unsigned char>(data[start]) & 0xC0) ==
+                              0x80) {
+    start++;
+  }
+  return start + validate_utf8_scalar(data + start, size - start);
+}
+
+__attribute__((target("sse4.2"))) __m128i
+utf8_lookup_sse42(const uint8_t (&table)[16]) {
+  return _mm_load_si128(reinterpret_cast<const __m128i *>(table));
+}
+
+// 以 prev 为前一块时 input 中的错误，全零表示没有错误
+__attribute__((target("sse4.2"))) __m128i utf8_errors_sse42(__m128i input,
+                                                            __m128i prev) {
+  using namespace utf8_lookup;
+  const __m128i nibble = _mm_set1_epi8(0x0F);
+  __m128i prev1 = _mm_alignr_epi8(input, prev, 15);
+  __m128i byte_1_high = _mm_shuffle_epi8(
+      utf8_lookup_sse42(BYTE_1_HIGH),
+      _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble));
+  __m128i byte_1_low = _mm_shuffle_epi8(utf8_lookup_sse42(BYTE_1_LOW),
+                                        _mm_and_si128(prev1, nibble));
+  __m128i byte_2_high = _mm_shuffle_epi8(
+      utf8_lookup_sse42(BYTE_2_HIGH),
+      _mm_and_si128(_mm_srli_epi16(input, 4), nibble));
+  __m128i special =
+      _mm_and_si128(_mm_and_si128(byte_1_high, byte_1_low), byte_2_high);
+  // 往前第2、3个字节是三、四字节字符的前导字节时，当前字节必须是后续字节
+  __m128i prev2 = _mm_alignr_epi8(input, prev, 14);
+  __m128i prev3 = _mm_alignr_epi8(input, prev, 13);
+  __m128i must_be_continuation =
+      _mm_or_si128(_mm_subs_epu8(prev2, _mm_set1_epi8(0xE0 - 0x80)),
+                   _mm_subs_epu8(prev3, _mm_set1_epi8(0xF0 - 0x80)));
+  must_be_continuation = _mm_and_si128(
+      must_be_continuation, _mm_set1_epi8(static_cast<char>(0x80)));
+  return _mm_xor_si128(must_be_continuation, special);
+}
+
+__attribute__((target("sse4.2"))) size_t validate_utf8_sse42(const char *data,
+                                                             size_t size) {
+  const __m128i incomplete_max = _mm_load_si128(
+      reinterpret_cast<const __m128i *>(utf8_lookup::INCOMPLETE_MAX + 16));
+  __m128i prev = _mm_setzero_si128();
+  __m128i prev_incomplete = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    __m128i input =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+    __m128i errors;
+    if (_mm_movemask_epi8(input) == 0) {
+      // 纯 ASCII 块只需确认上一块没有未完成的字符
+      errors = prev_incomplete;
+      prev_incomplete = _mm_setzero_si128();
+    } else {
+      errors = utf8_errors_sse42(input, prev);
+      prev_incomplete = _mm_subs_epu8(input, incomplete_max);
+    }
+    if (!_mm_testz_si128(errors, errors)) {
+      break;
+    }
+    prev = input;
+  }
+  return validate_utf8_from(data, size, i);
+}
+
+__attribute__((target("avx2"))) __m256i
+utf8_lookup_avx2(const uint8_t (&table)[16]) {
+  return _mm256_broadcastsi128_si256(
+      _mm_load_si128(reinterpret_cast<const __m128i *>(table)));
+}
+
+// 与 utf8_errors_sse42 相同，跨128位通道取前面的字节需先拼接前一块的高半部分
+__attribute__((target("avx2"))) __m256i utf8_errors_avx2(__m256i input,
+                                                         __m256i prev) {
+  using namespace utf8_lookup;
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+  __m256i shifted = _mm256_permute2x128_si256(prev, input, 0x21);
+  __m256i prev1 = _mm256_alignr_epi8(input, shifted, 15);
+  __m256i byte_1_high = _mm256_shuffle_epi8(
+      utf8_lookup_avx2(BYTE_1_HIGH),
+      _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble));
+  __m256i byte_1_low = _mm256_shuffle_epi8(utf8_lookup_avx2(BYTE_1_LOW),
+                                           _mm256_and_si256(prev1, nibble));
+  __m256i byte_2_high = _mm256_shuffle_epi8(
+      utf8_lookup_avx2(BYTE_2_HIGH),
+      _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble));
+  __m256i special = _mm256_and_si256(_mm256_and_si256(byte_1_high, byte_1_low),
+                                     byte_2_high);
+  __m256i prev2 = _mm256_alignr_epi8(input, shifted, 14);
+  __m256i prev3 = _mm256_alignr_epi8(input, shifted, 13);
+  __m256i must_be_continuation =
+      _mm256_or_si256(_mm256_subs_epu8(prev2, _mm256_set1_epi8(0xE0 - 0x80)),
+                      _mm256_subs_epu8(prev3, _mm256_set1_epi8(0xF0 - 0x80)));
+  must_be_continuation = _mm256_and_si256(
+      must_be_continuation, _mm256_set1_epi8(static_cast<char>(0x80)));
+  return _mm256_xor_si256(must_be_continuation, special);
+}
+
+__attribute__((target("avx2"))) size_t validate_utf8_avx2(const char *data,
+                                                          size_t size) {
+  const __m256i incomplete_max = _mm256_load_si256(
+      reinterpret_cast<const __m256i *>(utf8_lookup::INCOMPLETE_MAX));
+  __m256i prev = _mm256_setzero_si256();
+  __m256i prev_incomplete = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    __m256i input =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+    __m256i errors;
+    if (_mm256_movemask_epi8(input) == 0) {
+      errors = prev_incomplete;
+      prev_incomplete = _mm256_setzero_si256();
+    } else {
+      errors = utf8_errors_avx2(input, prev);
+      prev_incomplete = _mm256_subs_epu8(input, incomplete_max);
+    }
+    if (!_mm256_testz_si256(errors, errors)) {
+      break;
+    }
+    prev = input;
+  }
+  return validate_utf8_from(data, size, i);
+}
+
+#endif // TOKENIZER_SIMD_X86
+
+Level detect() {
+#ifdef TOKENIZER_SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return Level::AVX2;
+  }
+  if (__builtin_cpu_supports("sse4.2")) {
+    return Level::SSE42;
+  }
+#endif
+  return Level::SCALAR;
+}
+
+std::atomic<Level> &level_slot() {
+  static std::atomic<Level> level{detect()};
+  return level;
+}
+
+} // namespace
+
+Level detected_level() {
+  static const Level level = detect();
+  return level;
+}
+
+Level active_level() { return level_slot().load(std::memory_order_relaxed); }
+
+void set_level(Level level) {
+  if (static_cast<int>(level) > static_cast<int>(detected_level())) {
+    level = detected_level();
+  }
+  level_slot().store(level, std::memory_order_relaxed);
+}
+
+size_t find_non_blank(const char *data, size_t size) {
+  switch (active_level()) {
+#ifdef TOKENIZER_SIMD_X86
+  case Level::AVX2:
+    return find_non_blank_avx2(data, size);
+  case Level::SSE42:
+    return find_non_blank_sse42(data, size);
+#endif
+  default:
+    return find_non_blank_scalar(data, size);
+  }
+}
+
+size_t find_byte(const char *data, size_t size, char byte) {
+  switch (active_level()) {
+#ifdef TOKENIZER_SIMD_X86
+  case Level::AVX2:
+    return find_byte_avx2(data, size, byte);
+  case Level::SSE42:
+    return find_byte_sse42(data, size, byte);
+#endif
+  default:
+    return find_byte_scalar(data, size, byte);
+  }
+}
+
+size_t validate_utf8(const char *data, size_t size) {
+  switch (active_level()) {
+#ifdef TOKENIZER_SIMD_X86
+  case Level::AVX2:
+    return validate_utf8_avx2(data, size);
+  case Level::SSE42:
+    return validate_utf8_sse42(data, size);
+#endif
+  default:
+    return validate_utf8_scalar(data, size);
+  }
+}
+
+} // namespace tokenizer::simd
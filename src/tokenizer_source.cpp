@@ -0,0 +1,79 @@
+#include "../include/tokenizer.hpp"
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace tokenizer {
+
+SourceBuffer::SourceBuffer(SourceBuffer &&other) noexcept
+    : owned(std::move(other.owned)), mapped(other.mapped),
+      mapped_size(other.mapped_size) {
+  other.mapped = nullptr;
+  other.mapped_size = 0;
+}
+
+SourceBuffer &SourceBuffer::operator=(SourceBuffer &&other) noexcept {
+  if (this != &other) {
+    release();
+    owned = std::move(other.owned);
+    mapped = other.mapped;
+    mapped_size = other.mapped_size;
+    other.mapped = nullptr;
+    other.mapped_size = 0;
+  }
+  return *this;
+}
+
+void SourceBuffer::release() {
+  if (mapped != nullptr) {
+    munmap(const_cast<char *>(mapped), mapped_size);
+    mapped = nullptr;
+    mapped_size = 0;
+  }
+}
+
+void SourceBuffer::replace(size_t offset, size_t length,
+                           std::string_view text) {
+  if (mapped != nullptr) {
+    owned.assign(mapped, mapped_size);
+    release();
+  }
+  owned.replace(offset, length, text);
+}
+
+std::optional<SourceBuffer>
+SourceBuffer::map_file(const std::string &filename) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "Error: Failed to open file " << filename << std::endl;
+    return std::nullopt;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    std::cerr << "Error: Failed to stat file " << filename << std::endl;
+    close(fd);
+    return std::nullopt;
+  }
+
+  SourceBuffer buffer;
+  // 空文件无法映射，直接作为空输入
+  if (st.st_size > 0) {
+    void *addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ,
+                      MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+      std::cerr << "Error: Failed to map file " << filename << std::endl;
+      close(fd);
+      return std::nullopt;
+    }
+    madvise(addr, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+    buffer.mapped = static_cast<const char *>(addr);
+    buffer.mapped_size = static_cast<size_t>(st.st_size);
+  }
+  close(fd);
+  return buffer;
+}
+
+} // namespace tokenizer
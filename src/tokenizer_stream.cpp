@@ -0,0 +1,87 @@
+#include "../include/tokenizer.hpp"
+#include <cerrno>
+#include <unistd.h>
+
+namespace tokenizer {
+
+void ChunkReader::refill() {
+  // 丢弃 keep - 1 之前的输入，攒够一块再移动以摊薄开销
+  if (keep > base + 1) {
+    size_t drop = std::min(keep - 1 - base, window.size());
+    if (drop >= chunk_size || drop == window.size()) {
+      window.erase(0, drop);
+      base += drop;
+    }
+  }
+
+  size_t old_size = window.size();
+  window.resize(old_size + chunk_size);
+  size_t count = 0;
+  if (stream != nullptr) {
+    stream->read(window.data() + old_size,
+                 static_cast<std::streamsize>(chunk_size));
+    count = static_cast<size_t>(stream->gcount());
+  } else {
+    ssize_t result;
+    do {
+      result = ::read(fd, window.data() + old_size, chunk_size);
+    } while (result < 0 && errno == EINTR);
+    if (result < 0) {
+      window.resize(old_size);
+      eof = true;
+      throw std::runtime_error("Error: Failed to read input");
+    }
+    count = static_cast<size_t>(result);
+  }
+  window.resize(old_size + count);
+  if (count == 0) {
+    eof = true;
+  }
+}
+
+size_t ChunkReader::find_newline(size_t pos, bool commit) {
+  while (true) {
+    size_t from = pos - base;
+    size_t found = from + simd::find_byte(window.data() + from,
+                                          window.size() - from, '\n');
+    if (found < window.size()) {
+      return base + found;
+    }
+    pos = base + window.size();
+    if (eof) {
+      return pos;
+    }
+    // 注释行中已扫描的部分不再需要
+    if (commit) {
+      keep = pos;
+    }
+    refill();
+  }
+}
+
+size_t ChunkReader::skip_blanks(size_t pos) {
+  while (true) {
+    size_t from = pos - base;
+    size_t found =
+        from + simd::find_non_blank(window.data() + from, window.size() - from);
+    if (found < window.size()) {
+      return base + found;
+    }
+    pos = base + window.size();
+    if (eof) {
+      return pos;
+    }
+    keep = pos;
+    refill();
+  }
+}
+
+std::optional<Token> StreamTokenizer::next_token() {
+  auto view = next_view();
+  if (!view) {
+    return std::nullopt;
+  }
+  return lexer.to_token(*view, text(*view));
+}
+
+} // namespace tokenizer
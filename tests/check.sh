@@ -0,0 +1,78 @@
+#!/bin/sh
+# 回归检查：在临时目录中以各种选项运行 grammar_parser，
+# token 列表、语法树与 AST 都应与 tests/expected 中记录的结果一致
+# 分别覆盖 SLR(1) 与 LALR(1)、顺序与并行、首次运行与命中缓存，以及损坏的缓存
+# test.sgo 太小，--parallel 在这里退回顺序分析，多块并行由 tokenizer_check 检查
+set -u
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+BIN="$ROOT/grammar_parser"
+EXPECTED="$ROOT/tests/expected"
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cp "$ROOT/grammar.txt" "$ROOT/test.sgo" "$WORK/"
+cd "$WORK" || exit 1
+
+failed=0
+
+fail() {
+  echo "FAIL $1"
+  failed=1
+  run_failed=1
+}
+
+# 运行一次并与期望结果比较
+# $1 为说明，$2 为 cold（应重新构建分析表）或 cached（应命中缓存），其余为选项
+run() {
+  name=$1
+  expect=$2
+  shift 2
+  run_failed=0
+  if ! "$BIN" "$@" >out.txt 2>err.txt; then
+    fail "$name: exit status"
+    cat err.txt
+    return
+  fi
+  sed -n '/^Tokens from file/,/^Total tokens/p' out.txt >tokens.txt
+  cmp -s tokens.txt "$EXPECTED/tokens.txt" || fail "$name: tokens differ"
+  sha256sum --quiet -c "$EXPECTED/trees.sha256" >/dev/null 2>&1 ||
+    fail "$name: parse tree differs"
+  if grep -q '^Loaded parser tables from' out.txt; then
+    [ "$expect" = cached ] || fail "$name: unexpected cache hit"
+  else
+    [ "$expect" = cold ] || fail "$name: cache was not used"
+  fi
+  [ "$run_failed" -ne 0 ] || echo "ok   $name"
+}
+
+# 把文件中间的一个字节按位取反
+flip_byte() {
+  size=$(wc -c <"$1")
+  offset=$((size / 2))
+  byte=$(od -An -tu1 -j "$offset" -N1 "$1" | tr -d ' ')
+  printf "$(printf '\\%03o' $((byte ^ 255)))" |
+    dd of="$1" bs=1 seek="$offset" conv=notrunc 2>/dev/null
+}
+
+run "slr cold" cold
+run "slr cached" cached
+run "lalr cold" cold --lalr
+run "lalr cached" cached --lalr
+run "slr cached after lalr" cached
+run "parallel" cached --parallel
+run "utf8" cached --utf8
+run "tolerant" cached --tolerant
+run "lalr parallel utf8 tolerant" cached --lalr --parallel --utf8 --tolerant
+
+flip_byte slr_parser.cache
+run "corrupted cache rejected" cold
+run "cache rewritten" cached
+head -c 100 slr_parser.cache >truncated.cache
+mv truncated.cache slr_parser.cache
+run "truncated cache rejected" cold
+
+if [ "$failed" -ne 0 ]; then
+  echo "check failed"
+  exit 1
+fi
+echo "all checks passed"
@@ -0,0 +1,188 @@
+// 词法分析的一致性检查：并行分析、增量分析与各级 SIMD 内核的结果
+// 都应与顺序分析完全相同
+// 用法：tokenizer_check <语法文件> <源文件>
+#include "../include/grammar_parser.hpp"
+#include "../include/tokenizer.hpp"
+#include "../include/tokenizer_simd.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <random>
+#include <sstream>
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const std::string &what) {
+  if (!ok) {
+    std::cout << "FAIL " << what << std::endl;
+    failures++;
+  }
+}
+
+bool same_tokens(const tokenizer::TokenStream &a,
+                 const tokenizer::TokenStream &b) {
+  return a.terminal_ids == b.terminal_ids && a.offsets == b.offsets &&
+         a.lengths == b.lengths && a.char_modes == b.char_modes;
+}
+
+bool same_diagnostics(const std::vector<tokenizer::LexDiagnostic> &a,
+                      const std::vector<tokenizer::LexDiagnostic> &b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); i++) {
+    if (a[i].offset != b[i].offset || a[i].byte != b[i].byte ||
+        a[i].in_char_mode != b[i].in_char_mode) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// 顺序分析的结果，出错时返回空
+std::optional<tokenizer::TokenStream>
+tokenize(const tokenizer::Lexer &lexer, const std::string &text,
+         bool tolerant, std::vector<tokenizer::LexDiagnostic> *diagnostics) {
+  tokenizer::Tokenizer tokenizer(lexer, tokenizer::SourceBuffer(text));
+  tokenizer.set_error_tolerant(tolerant);
+  try {
+    auto tokens = tokenizer.tokenize();
+    if (diagnostics) {
+      *diagnostics = tokenizer.get_diagnostics();
+    }
+    return tokens;
+  } catch (const std::exception &) {
+    return std::nullopt;
+  }
+}
+
+// 把源文件重复到超过1MB，使并行分析真正切分为多块
+void check_parallel(const tokenizer::Lexer &lexer, const std::string &source) {
+  std::string text;
+  while (text.size() < (1 << 20)) {
+    text += source;
+    text += '\n';
+  }
+  for (bool tolerant : {false, true}) {
+    std::vector<tokenizer::LexDiagnostic> expected_diagnostics;
+    auto expected = tokenize(lexer, text, tolerant, &expected_diagnostics);
+    check(expected.has_value(), "sequential tokenize");
+    if (!expected) {
+      continue;
+    }
+    for (size_t threads : {2, 4, 7}) {
+      tokenizer::Tokenizer tokenizer(lexer, tokenizer::SourceBuffer(text));
+      tokenizer.set_error_tolerant(tolerant);
+      auto tokens = tokenizer.tokenize_parallel(threads);
+      check(same_tokens(tokens, *expected) &&
+                same_diagnostics(tokenizer.get_diagnostics(),
+                                 expected_diagnostics),
+            "tokenize_parallel(" + std::to_string(threads) + ")");
+    }
+  }
+}
+
+// 随机编辑后增量更新的token流应与重新分析整个输入的结果相同
+void check_incremental(const tokenizer::Lexer &lexer,
+                       const std::string &source) {
+  const char *pieces[] = {" ", "\n", "'", "a", "1", "if", "//", "\\", "(",
+                          ";", "=", "<=", "' '", "'a'", "x y", "// c d\n",
+                          "\xC3\xA9"};
+  std::mt19937 rng(42);
+  for (bool tolerant : {false, true}) {
+    std::string text = source;
+    tokenizer::Tokenizer tokenizer(lexer, tokenizer::SourceBuffer(text));
+    tokenizer.set_error_tolerant(tolerant);
+    auto tokens = tokenizer.tokenize();
+    for (int i = 0; i < 2000; i++) {
+      size_t offset = rng() % (text.size() + 1);
+      size_t deleted = std::min<size_t>(rng() % 4, text.size() - offset);
+      std::string inserted =
+          rng() % 3 ? pieces[rng() % std::size(pieces)] : "";
+      std::string edited = text;
+      edited.replace(offset, deleted, inserted);
+
+      std::vector<tokenizer::LexDiagnostic> expected_diagnostics;
+      auto expected = tokenize(lexer, edited, tolerant, &expected_diagnostics);
+      bool applied = true;
+      try {
+        tokenizer.apply_edit(tokens, {offset, deleted, inserted});
+      } catch (const std::exception &) {
+        applied = false;
+      }
+      check(applied == expected.has_value(),
+            "apply_edit error at edit " + std::to_string(i));
+      if (!applied || !expected) {
+        // 非容错模式出错后从原始输入重新开始
+        text = source;
+        tokenizer = tokenizer::Tokenizer(lexer, tokenizer::SourceBuffer(text));
+        tokenizer.set_error_tolerant(tolerant);
+        tokens = tokenizer.tokenize();
+        continue;
+      }
+      text = edited;
+      check(same_tokens(tokens, *expected) &&
+                same_diagnostics(tokenizer.get_diagnostics(),
+                                 expected_diagnostics),
+            "apply_edit at edit " + std::to_string(i));
+    }
+  }
+}
+
+// 各级 SIMD 内核的分析结果应与逐字节实现相同
+void check_simd(const tokenizer::Lexer &lexer, const std::string &source) {
+  using tokenizer::simd::Level;
+  tokenizer::simd::set_level(Level::SCALAR);
+  auto expected = tokenize(lexer, source, true, nullptr);
+  for (Level level : {Level::SSE42, Level::AVX2}) {
+    tokenizer::simd::set_level(level);
+    auto tokens = tokenize(lexer, source, true, nullptr);
+    check(tokens && expected && same_tokens(*tokens, *expected),
+          "SIMD level " + std::to_string(static_cast<int>(level)));
+  }
+  tokenizer::simd::set_level(tokenizer::simd::detected_level());
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc != 3) {
+    std::cerr << "Usage: " << argv[0] << " <grammar file> <source file>"
+              << std::endl;
+    return 2;
+  }
+  auto rules = grammar::parse_grammar_from_file(argv[1]);
+  if (!rules) {
+    std::cerr << "Failed to parse grammar file: " << argv[1] << std::endl;
+    return 2;
+  }
+  std::ifstream file(argv[2]);
+  if (!file.is_open()) {
+    std::cerr << "Failed to open input file: " << argv[2] << std::endl;
+    return 2;
+  }
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  std::string source = buffer.str();
+
+  grammar::Grammar grammar(rules.value());
+  auto promotion = grammar.promote_regular_nonterminals();
+  tokenizer::Lexer lexer(grammar.extract_terminals(), promotion);
+
+  // 随机编辑会产生非法输入，非容错模式的词法错误报告在这里是预期的
+  std::cerr.rdbuf(nullptr);
+  check_parallel(lexer, source);
+  check_incremental(lexer, source);
+  check_simd(lexer, source);
+
+  if (failures != 0) {
+    std::cout << failures << " tokenizer check(s) failed" << std::endl;
+    return 1;
+  }
+  std::cout << "tokenizer checks passed" << std::endl;
+  return 0;
+}
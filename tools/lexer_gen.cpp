@@ -0,0 +1,126 @@
+// 词法表生成器：读取语法文件，构建词法自动机，输出可直接编译进程序的 C++ 头文件
+// 用法：lexer_gen grammar.txt include/lexer_tables.hpp
+#include "../include/grammar_parser.hpp"
+#include "../include/tokenizer.hpp"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// 转义为 C++ 字符串字面量，不可打印字符使用三位八进制转义，避免与后续数字连读
+static std::string escape(const std::string &value) {
+  std::string result = "\"";
+  for (char c : value) {
+    auto byte = static_cast<unsigned char>(c);
+    if (c == '"' || c == '\\') {
+      result += '\\';
+      result += c;
+    } else if (byte < 0x20 || byte >= 0x7F || c == '?') {
+      // '?' 也转义，避免构成三字符组
+      char octal[8];
+      std::snprintf(octal, sizeof(octal), "\\%03o", byte);
+      result += octal;
+    } else {
+      result += c;
+    }
+  }
+  return result + "\"";
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 3) {
+    std::cerr << "Usage: " << argv[0] << " <grammar file> <output header>"
+              << std::endl;
+    return 1;
+  }
+  const std::string grammar_file = argv[1];
+  const std::string output_file = argv[2];
+
+  auto text = grammar::GrammarFile::map(grammar_file);
+  if (!text) {
+    return 1;
+  }
+  auto rules = grammar::parse_grammar(text->view());
+  if (!rules) {
+    std::cerr << "Failed to parse grammar file: " << grammar_file << std::endl;
+    return 1;
+  }
+
+  // 与 main 中相同的步骤，保证终结符编号一致
+  grammar::Grammar grammar(rules.value());
+  auto promotion = grammar.promote_regular_nonterminals();
+  auto terminals = grammar.extract_terminals();
+  if (terminals.empty()) {
+    std::cerr << "Error: Grammar has no terminals" << std::endl;
+    return 1;
+  }
+  tokenizer::LexerAutomaton automaton(terminals, promotion);
+
+  std::ostringstream out;
+  out << "// 由 tools/lexer_gen 根据 " << grammar_file
+      << " 生成，请勿手工修改\n"
+         "// 语法文件改动后运行 make lexer-tables 重新生成\n"
+         "#ifndef LEXER_TABLES_HPP\n"
+         "#define LEXER_TABLES_HPP\n\n"
+         "#include \"tokenizer.hpp\"\n"
+         "#include <string_view>\n\n"
+         "namespace tokenizer::generated {\n\n";
+  out << "constexpr uint64_t GRAMMAR_HASH = 0x" << std::hex
+      << grammar::hash_grammar_text(text->view()) << std::dec << "ULL;\n";
+  out << "constexpr uint32_t TABLES_VERSION = "
+      << tokenizer::LEXER_TABLES_VERSION << ";\n\n";
+
+  out << "constexpr size_t TERMINAL_COUNT = " << terminals.size() << ";\n";
+  out << "constexpr std::string_view TERMINAL_VALUES[] = {\n";
+  for (const auto &terminal : terminals) {
+    out << "    std::string_view(" << escape(terminal.value()) << ", "
+        << terminal.value().size() << "),\n";
+  }
+  out << "};\n";
+  out << "constexpr bool TERMINAL_IS_TOKEN[] = {";
+  for (size_t i = 0; i < terminals.size(); i++) {
+    out << (i % 16 == 0 ? "\n    " : " ")
+        << (terminals[i].is_token ? "true," : "false,");
+  }
+  out << "\n};\n\n";
+
+  out << "constexpr size_t STATE_COUNT = " << automaton.states << ";\n";
+  out << "constexpr size_t CLASS_COUNT = " << automaton.class_count << ";\n";
+  out << "constexpr uint8_t BYTE_CLASSES[256] = {";
+  for (size_t byte = 0; byte < 256; byte++) {
+    out << (byte % 16 == 0 ? "\n    " : " ")
+        << static_cast<int>(automaton.byte_classes[byte]) << ",";
+  }
+  out << "\n};\n";
+  out << "constexpr int32_t TRANSITIONS[] = {";
+  for (size_t state = 0; state < automaton.states; state++) {
+    out << "\n    ";
+    for (size_t cls = 0; cls < automaton.class_count; cls++) {
+      out << (cls == 0 ? "" : " ")
+          << automaton.transitions[state * automaton.class_count + cls] << ",";
+    }
+  }
+  out << "\n};\n";
+  out << "constexpr LexerAutomaton::Accept ACCEPTS[] = {\n";
+  for (size_t state = 0; state < automaton.states; state++) {
+    const auto &accept = automaton.accepts[state];
+    out << "    {" << accept.terminal << ", " << std::boolalpha
+        << accept.keyword_like << ", " << accept.char_mode_ok << ", "
+        << accept.helper << ", " << accept.token << "},\n"
+        << std::noboolalpha;
+  }
+  out << "};\n\n";
+  out << "} // namespace tokenizer::generated\n\n"
+         "#endif // LEXER_TABLES_HPP\n";
+
+  std::ofstream file(output_file);
+  if (!file.is_open()) {
+    std::cerr << "Error: Failed to open file " << output_file << std::endl;
+    return 1;
+  }
+  file << out.str();
+  std::cout << "Lexer tables written to " << output_file << ": "
+            << automaton.states << " states, " << automaton.class_count
+            << " byte classes" << std::endl;
+  return 0;
+}